@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "common/lf_queue.hpp"
+#include "common/logger.hpp"
+#include "common/thread_utils.hpp"
+#include "common/time_utils.hpp"
+
+#include "order_server/client_request.hpp"
+#include "market_data/market_update.hpp"
+
+using namespace Common;
+using namespace Exchange;
+
+/// Ping-pong latency and streaming throughput of LFQueue between two pinned threads, for the element types used in
+/// production and both cache line layouts.
+/// Usage: lf_queue_benchmark [producer_core] [consumer_core] [ping_pong_iterations] [streaming_elements]
+namespace {
+    constexpr size_t PING_PONG_QUEUE_SIZE = 1024;
+    constexpr size_t STREAMING_QUEUE_SIZES[] = {1024, 64 * 1024, ME_MAX_CLIENT_UPDATES};
+
+    const char *layoutToString(LFQueueLayout layout) {
+        return layout == LFQueueLayout::PADDED ? "PADDED" : "COMPACT";
+    }
+
+    auto ticksToNanos(Ticks ticks) {
+        return static_cast<double>(ticks) * TSCClock::instance().calibration().nanos_per_tick_;
+    }
+
+    auto percentile(const std::vector<Ticks> &sorted, double p) {
+        return ticksToNanos(sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())))]);
+    }
+
+    /// Round trip of one element through a pair of queues, the other thread echoes everything back.
+    template<typename T, LFQueueLayout Layout>
+    void pingPong(const char *type_name, int ping_core, int pong_core, size_t iterations) {
+        using Queue = LFQueue<T, std::allocator<T>, Layout>;
+        Queue ping(PING_PONG_QUEUE_SIZE), pong(PING_PONG_QUEUE_SIZE);
+
+        auto pong_thread = createAndStartThread(pong_core, "LFQ Pong", [&]() {
+            T value{};
+            for (size_t i = 0; i < iterations; ++i) {
+                while (!ping.pop(value));
+                while (!pong.push(value));
+            }
+        });
+
+        if (ping_core >= 0) {
+            setThreadCore(ping_core);
+        }
+
+        std::vector<Ticks> samples(iterations);
+        T value{}, echoed{};
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = rdtsc();
+            while (!ping.push(value));
+            while (!pong.pop(echoed));
+            samples[i] = rdtsc() - start;
+        }
+
+        pong_thread->join();
+        delete pong_thread;
+
+        std::sort(samples.begin(), samples.end());
+        printf("%-16s %-8s %5zuB ping-pong rtt ns  p50:%8.1f  p99:%8.1f  p99.9:%8.1f  max:%10.1f\n", type_name, layoutToString(Layout),
+               sizeof(T), percentile(samples, 0.5), percentile(samples, 0.99), percentile(samples, 0.999), ticksToNanos(samples.back()));
+    }
+
+    /// One-way stream of elements, either one push()/pop() at a time or in spans through tryClaimWrite()/peekRead().
+    template<typename T, LFQueueLayout Layout>
+    void streaming(const char *type_name, int producer_core, int consumer_core, size_t queue_size, size_t elements, bool batched) {
+        using Queue = LFQueue<T, std::allocator<T>, Layout>;
+        Queue queue(queue_size);
+        std::atomic<Ticks> end_ticks = {0};
+
+        auto consumer_thread = createAndStartThread(consumer_core, "LFQ Consumer", [&]() {
+            T value{};
+            size_t consumed = 0;
+            while (consumed < elements) {
+                if (batched) {
+                    const auto values = queue.peekRead(queue.capacity());
+                    consumed += values.size();
+                    queue.releaseRead(values.size());
+                } else if (queue.pop(value)) {
+                    ++consumed;
+                }
+            }
+            end_ticks = rdtsc();
+        });
+
+        if (producer_core >= 0) {
+            setThreadCore(producer_core);
+        }
+
+        const T value{};
+        const auto start = rdtsc();
+        for (size_t produced = 0; produced < elements;) {
+            if (batched) {
+                const auto slots = queue.tryClaimWrite(std::min(queue.capacity(), elements - produced));
+                for (auto &slot : slots) {
+                    new(&slot) T(value);
+                }
+                queue.commitWrite(slots.size());
+                produced += slots.size();
+            } else if (queue.push(value)) {
+                ++produced;
+            }
+        }
+
+        consumer_thread->join();
+        delete consumer_thread;
+
+        const auto seconds = ticksToNanos(end_ticks - start) / NANOS_TO_SECS;
+        printf("%-16s %-8s %5zuB queue:%-7zu %-9s %8.2f M msgs/s %8.1f MB/s\n", type_name, layoutToString(Layout), sizeof(T),
+               queue_size, batched ? "span" : "push/pop", static_cast<double>(elements) / seconds / 1e6,
+               static_cast<double>(elements * sizeof(T)) / seconds / 1e6);
+    }
+
+    template<typename T>
+    void benchmarkType(const char *type_name, int producer_core, int consumer_core, size_t ping_pong_iterations, size_t streaming_elements) {
+        pingPong<T, LFQueueLayout::COMPACT>(type_name, producer_core, consumer_core, ping_pong_iterations);
+        pingPong<T, LFQueueLayout::PADDED>(type_name, producer_core, consumer_core, ping_pong_iterations);
+
+        for (const auto queue_size : STREAMING_QUEUE_SIZES) {
+            for (const auto batched : {false, true}) {
+                streaming<T, LFQueueLayout::COMPACT>(type_name, producer_core, consumer_core, queue_size, streaming_elements, batched);
+                streaming<T, LFQueueLayout::PADDED>(type_name, producer_core, consumer_core, queue_size, streaming_elements, batched);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const int producer_core = argc > 1 ? atoi(argv[1]) : 0;
+    const int consumer_core = argc > 2 ? atoi(argv[2]) : 1;
+    const size_t ping_pong_iterations = argc > 3 ? std::stoul(argv[3]) : 1000000;
+    const size_t streaming_elements = argc > 4 ? std::stoul(argv[4]) : 10000000;
+
+    printf("producer core:%d consumer core:%d ping-pong iterations:%zu streaming elements:%zu\n", producer_core, consumer_core,
+           ping_pong_iterations, streaming_elements);
+
+    benchmarkType<MEClientRequest>("MEClientRequest", producer_core, consumer_core, ping_pong_iterations, streaming_elements);
+    benchmarkType<MEMarketUpdate>("MEMarketUpdate", producer_core, consumer_core, ping_pong_iterations, streaming_elements);
+    benchmarkType<LogBlock>("LogBlock", producer_core, consumer_core, ping_pong_iterations, streaming_elements);
+
+    return 0;
+}
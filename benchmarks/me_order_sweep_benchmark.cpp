@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/huge_page_allocator.hpp"
+#include "common/mem_pool.hpp"
+#include "common/time_utils.hpp"
+
+#include "matching_engine/me_order.hpp"
+
+using namespace Common;
+using namespace Exchange;
+
+/// Cost per order of sweeping a FIFO of resting orders the way MEOrderBook::checkForMatch() / match() consume the front
+/// of a level, for the previous 72 byte MEOrder layout and the current one cache line layout. Orders are linked in a
+/// shuffled pool order, as they end up after the pool has been churning for a while.
+/// Usage: me_order_sweep_benchmark [trials]
+namespace {
+    constexpr size_t RESTING_ORDERS[] = {1024, 16 * 1024, 256 * 1024, ME_MAX_ORDER_IDS};
+
+    /// MEOrder as laid out before the hot fields were packed into a single cache line.
+    struct LegacyMEOrder {
+        TickerId ticker_id_ = TickerId_INVALID;
+        OrderId client_order_id_ = OrderId_INVALID;
+        OrderId market_order_id_ = OrderId_INVALID;
+        ClientId client_id_ = ClientId_INVALID;
+        Side side_ = Side::INVALID;
+        Price price_ = Price_INVALID;
+        Qty qty_ = Qty_INVALID;
+        Priority priority_ = Priority_INVALID;
+
+        LegacyMEOrder *prev_order_ = nullptr;
+        LegacyMEOrder *next_order_ = nullptr;
+    };
+
+    auto ticksToNanos(Ticks ticks) {
+        return static_cast<double>(ticks) * TSCClock::instance().calibration().nanos_per_tick_;
+    }
+
+    /// Links num_orders orders from the pool into a circular FIFO, in a shuffled slot order.
+    template<typename T>
+    T* buildLevel(MemPool<T, HugePageAllocator<T>> &pool, std::vector<T*> &orders, std::mt19937_64 &rng) {
+        const auto num_orders = orders.size();
+        for (size_t i = 0; i < num_orders; ++i) {
+            orders[i] = pool.allocate();
+        }
+        std::shuffle(orders.begin(), orders.end(), rng);
+
+        for (size_t i = 0; i < num_orders; ++i) {
+            auto order = orders[i];
+            order->client_order_id_ = i;
+            order->market_order_id_ = i + 1;
+            order->client_id_ = static_cast<ClientId>(i % ME_MAX_NUM_CLIENTS);
+            order->side_ = Side::SELL;
+            order->price_ = 100;
+            order->qty_ = 10;
+            order->priority_ = i + 1;
+            order->prev_order_ = orders[(i + num_orders - 1) % num_orders];
+            order->next_order_ = orders[(i + 1) % num_orders];
+        }
+        return orders[0];
+    }
+
+    /// Fills the whole level with one aggressive order, reading every field a fill report needs and unlinking each order.
+    template<typename T>
+    auto sweep(T* first_order, size_t num_orders) {
+        Qty leaves_qty = static_cast<Qty>(num_orders * 10);
+        uint64_t checksum = 0;
+
+        auto order = first_order;
+        for (size_t i = 0; i < num_orders && order->price_ <= 100; ++i) {
+            const auto exec_qty = std::min(leaves_qty, order->qty_);
+            leaves_qty -= exec_qty;
+            order->qty_ -= exec_qty;
+            checksum += order->client_id_ + order->client_order_id_ + order->market_order_id_ + order->priority_ +
+                        static_cast<uint64_t>(order->side_) + exec_qty;
+
+            const auto next_order = order->next_order_;
+            order->prev_order_->next_order_ = next_order;
+            next_order->prev_order_ = order->prev_order_;
+            order->next_order_ = order->prev_order_ = nullptr;
+            order = next_order;
+        }
+        return checksum;
+    }
+
+    template<typename T>
+    void benchmarkLayout(const char *name, size_t trials) {
+        std::mt19937_64 rng(42);
+
+        for (const auto num_orders : RESTING_ORDERS) {
+            MemPool<T, HugePageAllocator<T>> pool(num_orders);
+            std::vector<T*> orders(num_orders);
+            std::vector<double> nanos_per_order;
+            uint64_t checksum = 0;
+
+            for (size_t trial = 0; trial < trials; ++trial) {
+                const auto first_order = buildLevel(pool, orders, rng);
+
+                const auto start = rdtsc();
+                checksum += sweep(first_order, num_orders);
+                nanos_per_order.push_back(ticksToNanos(rdtsc() - start) / static_cast<double>(num_orders));
+
+                for (auto order : orders) {
+                    pool.deallocate(order);
+                }
+            }
+
+            std::sort(nanos_per_order.begin(), nanos_per_order.end());
+            printf("%-14s %3zuB orders:%-8zu ns/order  min:%7.2f  median:%7.2f  max:%7.2f  (checksum:%llu)\n", name, sizeof(T),
+                   num_orders, nanos_per_order.front(), nanos_per_order[nanos_per_order.size() / 2], nanos_per_order.back(),
+                   static_cast<unsigned long long>(checksum));
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t trials = argc > 1 ? std::stoul(argv[1]) : 21;
+
+    printf("trials:%zu\n", trials);
+
+    benchmarkLayout<LegacyMEOrder>("LegacyMEOrder", trials);
+    benchmarkLayout<MEOrder>("MEOrder", trials);
+
+    return 0;
+}
@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/time_utils.hpp"
+#include "common/types.hpp"
+
+#include "matching_engine/matching_engine.hpp"
+#include "matching_engine/me_orderbook.hpp"
+#include "matching_engine/me_shard.hpp"
+
+using namespace Common;
+using namespace Exchange;
+
+/// Latency of MEOrderBook add / cancel / modify, driven in-process by a seeded synthetic order flow. The book reports into a
+/// MatchingEngine that is never started, so every response and market update goes through the production send path and
+/// logging, and the responses are drained between operations to track which orders are still resting. Every operation is
+/// timed with rdtsc() on its own, aggressive orders that do not fully fill have their remainder cancelled untimed.
+/// Usage: me_orderbook_benchmark [profile|all] [operations] [seed] [per_fill|per_level]
+namespace {
+    constexpr Price MID_PRICE = ME_MAX_PRICE_LEVELS / 2;
+
+    /// Mix of operations and shape of the book an order flow produces. Passive orders rest uniformly within price_range_
+    /// ticks of the touch, aggressive orders cross up to sweep_levels_ ticks past the mid.
+    struct OrderFlowProfile {
+        const char *name_;
+        uint32_t passive_weight_;
+        uint32_t aggressive_weight_;
+        uint32_t cancel_weight_;
+        uint32_t modify_weight_;
+        Price price_range_;
+        Qty max_qty_;
+        Price sweep_levels_;
+        Qty max_aggressive_qty_;
+        size_t max_resting_;
+    };
+
+    constexpr OrderFlowProfile PROFILES[] = {
+        {"passive",  80,  2, 15,  3,   32, 100,  2,   100, 200000},
+        {"cancel",   40,  2, 50,  8,   32, 100,  2,   100,  50000},
+        {"sweep",    85,  2, 10,  3,   16,  20, 16,   800,   1000},
+        {"narrow",   50, 10, 35,  5,    4, 100,  1,   300,  20000},
+        {"wide",     60,  5, 30,  5, 4096, 100, 64,  2000, 200000},
+    };
+
+    enum OperationType : size_t {
+        ADD_PASSIVE = 0,
+        ADD_AGGRESSIVE,
+        CANCEL,
+        MODIFY,
+        NUM_OPERATION_TYPES
+    };
+
+    constexpr const char *OPERATION_NAMES[] = {"add_passive", "add_aggressive", "cancel", "modify"};
+
+    auto ticksToNanos(Ticks ticks) {
+        return static_cast<double>(ticks) * TSCClock::instance().calibration().nanos_per_tick_;
+    }
+
+    auto percentile(const std::vector<Ticks> &sorted, double p) {
+        return ticksToNanos(sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())))]);
+    }
+
+    struct RestingOrder {
+        ClientId client_id_;
+        OrderId client_order_id_;
+        Side side_;
+        Price price_;
+        Qty qty_;
+    };
+
+    /// Generates the order flow and keeps track of the orders resting in the book.
+    class OrderFlow {
+    private:
+        const OrderFlowProfile &profile_;
+        std::mt19937_64 rng_;
+        std::discrete_distribution<size_t> operation_distribution_;
+
+        OrderId next_client_order_id_ = 1;
+        std::vector<RestingOrder> resting_;
+        std::unordered_map<OrderId, size_t> resting_index_;
+
+        auto uniform(uint64_t lo, uint64_t hi) {
+            return std::uniform_int_distribution<uint64_t>(lo, hi)(rng_);
+        }
+
+    public:
+        OrderFlow(const OrderFlowProfile &profile, uint64_t seed) : profile_(profile), rng_(seed),
+                operation_distribution_({static_cast<double>(profile.passive_weight_), static_cast<double>(profile.aggressive_weight_),
+                                         static_cast<double>(profile.cancel_weight_), static_cast<double>(profile.modify_weight_)}) {
+            resting_index_.reserve(profile.max_resting_ * 2);
+        }
+
+        auto nextOperation() {
+            auto operation = static_cast<OperationType>(operation_distribution_(rng_));
+            if ((operation == CANCEL || operation == MODIFY) && resting_.empty()) {
+                operation = ADD_PASSIVE;
+            }
+            if (operation == ADD_PASSIVE && resting_.size() >= profile_.max_resting_) {
+                operation = CANCEL;
+            }
+            return operation;
+        }
+
+        auto nextClientOrderId() noexcept {
+            return next_client_order_id_++;
+        }
+
+        static auto clientOf(OrderId client_order_id) noexcept {
+            return static_cast<ClientId>(client_order_id % ME_MAX_NUM_CLIENTS);
+        }
+
+        auto coin() {
+            return uniform(0, 1) == 1;
+        }
+
+        auto side() {
+            return coin() ? Side::BUY : Side::SELL;
+        }
+
+        auto passivePrice(Side side) {
+            const auto offset = uniform(1, profile_.price_range_);
+            return side == Side::BUY ? MID_PRICE - offset : MID_PRICE + offset;
+        }
+
+        auto aggressivePrice(Side side) {
+            return side == Side::BUY ? MID_PRICE + profile_.sweep_levels_ : MID_PRICE - profile_.sweep_levels_;
+        }
+
+        auto passiveQty(Qty max_qty) {
+            return static_cast<Qty>(uniform(1, max_qty));
+        }
+
+        auto passiveQty() {
+            return passiveQty(profile_.max_qty_);
+        }
+
+        auto aggressiveQty() {
+            return static_cast<Qty>(uniform(1, profile_.max_aggressive_qty_));
+        }
+
+        auto pickResting() -> RestingOrder& {
+            return resting_[uniform(0, resting_.size() - 1)];
+        }
+
+        void onResting(const RestingOrder &order) {
+            resting_index_[order.client_order_id_] = resting_.size();
+            resting_.push_back(order);
+        }
+
+        void onPartialFill(OrderId client_order_id, Qty leaves_qty) {
+            const auto it = resting_index_.find(client_order_id);
+            if (it != resting_index_.end()) {
+                resting_[it->second].qty_ = leaves_qty;
+            }
+        }
+
+        void onGone(OrderId client_order_id) {
+            const auto it = resting_index_.find(client_order_id);
+            if (it == resting_index_.end()) {
+                return;
+            }
+            const auto index = it->second;
+            resting_index_.erase(it);
+            if (index != resting_.size() - 1) {
+                resting_[index] = resting_.back();
+                resting_index_[resting_[index].client_order_id_] = index;
+            }
+            resting_.pop_back();
+        }
+
+        auto numResting() const noexcept {
+            return resting_.size();
+        }
+    };
+
+    /// Consumes the responses of the last operation, dropping filled and cancelled orders from the flow's resting set.
+    /// Returns the leaves qty of aggressive_order_id if it is still resting.
+    auto drainResponses(MEShardChannels &channels, OrderFlow &flow, OrderId aggressive_order_id) {
+        Qty aggressive_leaves_qty = 0;
+        while (true) {
+            const auto responses = channels.client_responses_.peekRead(channels.client_responses_.capacity());
+            if (responses.empty()) {
+                break;
+            }
+            for (const auto &sequenced_response : responses) {
+                const auto &response = sequenced_response.me_client_response_;
+                if (response.client_order_id_ == aggressive_order_id) {
+                    if (response.type_ == ClientResponseType::ACCEPTED || response.type_ == ClientResponseType::FILLED) {
+                        aggressive_leaves_qty = response.leaves_qty_;
+                    }
+                }
+                else if (response.type_ == ClientResponseType::FILLED && response.leaves_qty_ > 0) {
+                    flow.onPartialFill(response.client_order_id_, response.leaves_qty_);
+                }
+                else if (response.type_ == ClientResponseType::FILLED || response.type_ == ClientResponseType::CANCELED) {
+                    flow.onGone(response.client_order_id_);
+                }
+            }
+            channels.client_responses_.releaseRead(responses.size());
+        }
+        return aggressive_leaves_qty;
+    }
+
+    void benchmarkProfile(const OrderFlowProfile &profile, size_t operations, uint64_t seed, ExecutionReportMode execution_report_mode) {
+        // Never started and without books of its own, it only serves as the book's output sink.
+        auto channels = new MEShardChannels();
+        auto matching_engine = new MatchingEngine(0, 1, channels, InstrumentConfigs(), "", execution_report_mode);
+        Logger logger("me_orderbook_benchmark.log");
+        auto order_book = new MEOrderBook(0, InstrumentConfig(), execution_report_mode, matching_engine, &logger);
+
+        OrderFlow flow(profile, seed);
+        std::array<std::vector<Ticks>, NUM_OPERATION_TYPES> samples;
+        for (auto &operation_samples : samples) {
+            operation_samples.reserve(operations);
+        }
+
+        // Warms the book up to half its resting limit before anything is timed.
+        while (flow.numResting() < profile.max_resting_ / 2) {
+            const auto client_order_id = flow.nextClientOrderId();
+            const auto side = flow.side();
+            const RestingOrder resting{OrderFlow::clientOf(client_order_id), client_order_id, side, flow.passivePrice(side), flow.passiveQty()};
+            order_book->add(resting.client_id_, client_order_id, side, resting.price_, resting.qty_, 0);
+            flow.onResting(resting);
+            drainResponses(*channels, flow, OrderId_INVALID);
+        }
+
+        Ticks total_ticks = 0;
+        for (size_t i = 0; i < operations; ++i) {
+            const auto operation = flow.nextOperation();
+            OrderId aggressive_order_id = OrderId_INVALID;
+            RestingOrder resting{};
+            Ticks start = 0, end = 0;
+
+            switch (operation) {
+                case ADD_PASSIVE: {
+                    const auto client_order_id = flow.nextClientOrderId();
+                    const auto side = flow.side();
+                    resting = {OrderFlow::clientOf(client_order_id), client_order_id, side, flow.passivePrice(side), flow.passiveQty()};
+
+                    start = rdtsc();
+                    order_book->add(resting.client_id_, client_order_id, side, resting.price_, resting.qty_, 0);
+                    end = rdtsc();
+
+                    flow.onResting(resting);
+                }
+                break;
+                case ADD_AGGRESSIVE: {
+                    aggressive_order_id = flow.nextClientOrderId();
+                    const auto side = flow.side();
+                    const auto price = flow.aggressivePrice(side);
+                    const auto qty = flow.aggressiveQty();
+                    resting = {OrderFlow::clientOf(aggressive_order_id), aggressive_order_id, side, price, qty};
+
+                    start = rdtsc();
+                    order_book->add(resting.client_id_, aggressive_order_id, side, price, qty, 0);
+                    end = rdtsc();
+                }
+                break;
+                case CANCEL: {
+                    resting = flow.pickResting();
+
+                    start = rdtsc();
+                    order_book->cancel(resting.client_id_, resting.client_order_id_);
+                    end = rdtsc();
+
+                    flow.onGone(resting.client_order_id_);
+                }
+                break;
+                case MODIFY: {
+                    // Half size downs that keep priority, half re-prices that re-queue.
+                    auto &modified = flow.pickResting();
+                    if (flow.coin()) {
+                        modified.price_ = flow.passivePrice(modified.side_);
+                        modified.qty_ = flow.passiveQty();
+                    }
+                    else {
+                        modified.qty_ = flow.passiveQty(modified.qty_);
+                    }
+                    resting = modified;
+
+                    start = rdtsc();
+                    order_book->modify(resting.client_id_, resting.client_order_id_, resting.price_, resting.qty_);
+                    end = rdtsc();
+                }
+                break;
+                case NUM_OPERATION_TYPES:
+                break;
+            }
+
+            samples[operation].push_back(end - start);
+            total_ticks += end - start;
+
+            if (drainResponses(*channels, flow, aggressive_order_id) > 0) {
+                // Immediate-or-cancel, the remainder would otherwise rest through the mid.
+                order_book->cancel(resting.client_id_, aggressive_order_id);
+                drainResponses(*channels, flow, OrderId_INVALID);
+            }
+        }
+
+        const auto seconds = ticksToNanos(total_ticks) / NANOS_TO_SECS;
+        printf("profile:%-7s mode:%-9s seed:%llu operations:%zu resting_at_end:%zu throughput:%.0f ops/s (time inside the book only)\n",
+               profile.name_, executionReportModeToString(execution_report_mode).c_str(), static_cast<unsigned long long>(seed),
+               operations, flow.numResting(), static_cast<double>(operations) / seconds);
+        for (size_t operation = 0; operation < NUM_OPERATION_TYPES; ++operation) {
+            auto &operation_samples = samples[operation];
+            if (operation_samples.empty()) {
+                continue;
+            }
+            std::sort(operation_samples.begin(), operation_samples.end());
+            printf("  %-15s count:%-9zu ns  p50:%8.1f  p99:%8.1f  p99.9:%8.1f  max:%10.1f\n", OPERATION_NAMES[operation],
+                   operation_samples.size(), percentile(operation_samples, 0.5), percentile(operation_samples, 0.99),
+                   percentile(operation_samples, 0.999), ticksToNanos(operation_samples.back()));
+        }
+
+        delete order_book;
+        delete matching_engine;
+        delete channels;
+    }
+}
+
+int main(int argc, char **argv) {
+    const std::string profile_name = argc > 1 ? argv[1] : "all";
+    const size_t operations = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    const uint64_t seed = argc > 3 ? std::stoull(argv[3]) : 42;
+    const std::string execution_reports = argc > 4 ? argv[4] : "per_fill";
+    ASSERT(execution_reports == "per_fill" || execution_reports == "per_level", "Invalid execution report mode:" + execution_reports);
+    const auto execution_report_mode = (execution_reports == "per_level" ? ExecutionReportMode::PER_LEVEL : ExecutionReportMode::PER_FILL);
+
+    bool found = false;
+    for (const auto &profile : PROFILES) {
+        if (profile_name == "all" || profile_name == profile.name_) {
+            benchmarkProfile(profile, operations, seed, execution_report_mode);
+            found = true;
+        }
+    }
+    ASSERT(found, "Unknown profile:" + profile_name);
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "macros.hpp"
+
+namespace Common {
+    constexpr size_t BROADCAST_QUEUE_MAX_READERS = 8;
+
+    /// Single writer, multi reader ring. Every element is written once and read by every registered reader, each reader
+    /// tracks its own cursor and the writer only reuses a slot once the slowest reader has released it. A reader's cursor
+    /// is the global position of the element, so it doubles as a sequence number shared by all readers.
+    template<typename T, typename Alloc = std::allocator<T>>
+    class BroadcastQueue final : private Alloc {
+    private:
+        using allocator_traits = std::allocator_traits<Alloc>;
+        using size_type = typename allocator_traits::size_type;
+
+        struct alignas(CACHE_LINE_SIZE) ReaderCursor {
+            std::atomic<size_type> next_read_index_ = {0};
+            size_type next_write_index_cached_ = 0;
+        };
+
+        alignas(CACHE_LINE_SIZE) size_type mask_ = 0;
+        T* store_;
+        std::atomic<size_t> num_readers_ = {0};
+
+        alignas(CACHE_LINE_SIZE) std::atomic<size_type> next_write_index_ = {0};
+        size_type min_read_index_cached_ = 0;
+
+        std::array<ReaderCursor, BROADCAST_QUEUE_MAX_READERS> readers_;
+
+        // Slots are overwritten without running destructors.
+        static_assert(std::is_trivially_destructible_v<T>);
+        static_assert(std::atomic<size_type>::is_always_lock_free);
+
+    public:
+        using ReaderId = size_t;
+
+        explicit BroadcastQueue(size_type capacity, const Alloc& alloc = Alloc()) : Alloc{alloc}, mask_(capacity - 1),
+                store_(allocator_traits::allocate(*this, capacity)) {
+            ASSERT(capacity && !(capacity & mask_), "BroadcastQueue capacity must be a power of two:" + std::to_string(capacity));
+        }
+
+        ~BroadcastQueue() {
+            allocator_traits::deallocate(*this, store_, capacity());
+        }
+
+        /// Registers a reader which sees every element written from now on. Readers are never removed, a reader that stops
+        /// releasing elements eventually blocks the writer.
+        auto addReader() noexcept -> ReaderId {
+            const auto reader = num_readers_.load(std::memory_order_relaxed);
+            ASSERT(reader < BROADCAST_QUEUE_MAX_READERS, "BroadcastQueue has too many readers:" + std::to_string(reader));
+
+            const auto next_write_index = next_write_index_.load(std::memory_order_acquire);
+            readers_[reader].next_read_index_.store(next_write_index, std::memory_order_relaxed);
+            readers_[reader].next_write_index_cached_ = next_write_index;
+            num_readers_.store(reader + 1, std::memory_order_release);
+            return reader;
+        }
+
+        bool push(const T& value) {
+            return emplace(value);
+        }
+
+        template<typename... Args>
+        bool emplace(Args&&... args) {
+            const auto slots = tryClaimWrite(1);
+            if (slots.empty()) return false;
+
+            new(slots.data()) T(std::forward<Args>(args)...);
+            commitWrite(1);
+            return true;
+        }
+
+        /// Up to n slots the writer can fill, fewer if the slowest reader is close to a full lap behind or the ring wraps around.
+        std::span<T> tryClaimWrite(size_type n) noexcept {
+            const auto next_write_index = next_write_index_.load(std::memory_order_relaxed);
+            if (capacity() - (next_write_index - min_read_index_cached_) < n) {
+                min_read_index_cached_ = minReadIndex(next_write_index);
+            }
+
+            const auto available = std::min({n, capacity() - (next_write_index - min_read_index_cached_),
+                                              capacity() - (next_write_index & mask_)});
+            return {element(next_write_index), available};
+        }
+
+        void commitWrite(size_type n) noexcept {
+            const auto next_write_index = next_write_index_.load(std::memory_order_relaxed);
+            HOT_ASSERT(next_write_index + n - min_read_index_cached_ <= capacity(), "BroadcastQueue commitWrite() past claimed slots.");
+            next_write_index_.store(next_write_index + n, std::memory_order_release);
+        }
+
+        /// Up to n elements not yet released by this reader, fewer if the ring wraps around.
+        std::span<const T> peekRead(ReaderId reader, size_type n) noexcept {
+            auto &cursor = readers_[reader];
+            const auto next_read_index = cursor.next_read_index_.load(std::memory_order_relaxed);
+            if (cursor.next_write_index_cached_ - next_read_index < n) {
+                cursor.next_write_index_cached_ = next_write_index_.load(std::memory_order_acquire);
+            }
+
+            const auto available = std::min({n, cursor.next_write_index_cached_ - next_read_index, capacity() - (next_read_index & mask_)});
+            return {element(next_read_index), available};
+        }
+
+        void releaseRead(ReaderId reader, size_type n) noexcept {
+            auto &cursor = readers_[reader];
+            const auto next_read_index = cursor.next_read_index_.load(std::memory_order_relaxed);
+            HOT_ASSERT(next_read_index + n <= cursor.next_write_index_cached_, "BroadcastQueue releaseRead() past peeked elements.");
+            cursor.next_read_index_.store(next_read_index + n, std::memory_order_release);
+        }
+
+        /// Global position of the next element this reader will see.
+        auto readIndex(ReaderId reader) const noexcept {
+            return readers_[reader].next_read_index_.load(std::memory_order_relaxed);
+        }
+
+        /// Elements the slowest reader has not released yet.
+        auto size() const noexcept {
+            const auto next_write_index = next_write_index_.load(std::memory_order_acquire);
+            return next_write_index - minReadIndex(next_write_index);
+        }
+
+        auto capacity() const noexcept {
+            return 1 + mask_;
+        }
+
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        BroadcastQueue() = delete;
+        BroadcastQueue(const BroadcastQueue&) = delete;
+        BroadcastQueue(const BroadcastQueue&&) = delete;
+        BroadcastQueue& operator=(const BroadcastQueue&) = delete;
+        BroadcastQueue& operator=(const BroadcastQueue&&) = delete;
+
+    private:
+        T* element(size_type location) const noexcept {
+            return &store_[mask_ & location];
+        }
+
+        // With no readers registered nothing holds the writer back.
+        size_type minReadIndex(size_type next_write_index) const noexcept {
+            auto min_read_index = next_write_index;
+            const auto num_readers = num_readers_.load(std::memory_order_acquire);
+            for (size_t i = 0; i < num_readers; ++i) {
+                min_read_index = std::min(min_read_index, readers_[i].next_read_index_.load(std::memory_order_acquire));
+            }
+            return min_read_index;
+        }
+    };
+}
@@ -17,7 +17,14 @@ int main() {
   logger.log("Logging a float:% and a double:%\n", f, d);
   logger.log("Logging a C-string:'%'\n", s);
   logger.log("Logging a string:'%'\n", ss);
-  logger.log("Logging without arguments");
+  logger.log("Logging without arguments\n");
+
+  // Same records written raw, run: log_decoder logging_example.bin.log
+  Logger binary_logger("logging_example.bin.log", LogMode::BINARY);
+
+  binary_logger.log("Logging a char:% an int:% and an unsigned:%\n", c, i, ul);
+  binary_logger.log("Logging a float:% and a double:%\n", f, d);
+  binary_logger.log("Logging a C-string:'%' and a string:'%' at 100%%\n", s, ss);
 
   return 0;
-}
\ No newline at end of file
+}
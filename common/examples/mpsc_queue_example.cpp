@@ -0,0 +1,48 @@
+#include <array>
+
+#include "common/mpsc_queue.hpp"
+#include "common/thread_utils.hpp"
+
+using namespace Common;
+
+struct TaggedValue {
+    int producer_ = -1;
+    int value_ = 0;
+};
+
+constexpr int NUM_PRODUCERS = 4;
+constexpr int NUM_VALUES = 1000000;
+
+void producer(MPSCQueue<TaggedValue>& q, int producer_id) {
+    for (int i = 0; i < NUM_VALUES; ++i) {
+        while (!q.emplace(TaggedValue{producer_id, i}));
+    }
+}
+
+int main() {
+    MPSCQueue<TaggedValue> q(1024);
+
+    std::array<std::thread*, NUM_PRODUCERS> producer_threads;
+    for (int i = 0; i < NUM_PRODUCERS; ++i) {
+        producer_threads[i] = createAndStartThread(-1, "MPSCQ Producer " + std::to_string(i), producer, std::ref(q), i);
+    }
+
+    // Values from different producers interleave, but each producer's values must come out in the order it pushed them.
+    std::array<int, NUM_PRODUCERS> next_expected{};
+    TaggedValue value;
+    for (int received = 0; received < NUM_PRODUCERS * NUM_VALUES;) {
+        if (q.pop(value)) {
+            ASSERT(value.value_ == next_expected[value.producer_], "producer:" + std::to_string(value.producer_) + " expected:" +
+                   std::to_string(next_expected[value.producer_]) + " received:" + std::to_string(value.value_));
+            ++next_expected[value.producer_];
+            ++received;
+        }
+    }
+
+    for (auto thread : producer_threads) {
+        thread->join();
+    }
+
+    std::cout << "consumer received " << NUM_VALUES << " values in order from each of " << NUM_PRODUCERS << " producers." << std::endl;
+    return 0;
+}
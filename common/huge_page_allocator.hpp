@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+
+#include "macros.hpp"
+
+namespace Common {
+    enum class HugePageSize : uint8_t {
+        NONE = 0,
+        HUGE_2MB = 1,
+        HUGE_1GB = 2
+    };
+
+    constexpr size_t SMALL_PAGE_BYTES = 4 * 1024;
+
+    inline constexpr auto hugePageBytes(HugePageSize page_size) noexcept -> size_t {
+        switch (page_size) {
+            case HugePageSize::HUGE_2MB:
+                return 2 * 1024 * 1024;
+            case HugePageSize::HUGE_1GB:
+                return 1024 * 1024 * 1024;
+            case HugePageSize::NONE:
+                break;
+        }
+        return SMALL_PAGE_BYTES;
+    }
+
+    struct HugePageConfig {
+        HugePageSize page_size_ = HugePageSize::HUGE_2MB;
+
+        // mlock() the region so it is never swapped out, failure (e.g. RLIMIT_MEMLOCK) only prints a warning.
+        bool lock_ = false;
+
+        // Touch every page up front so nothing faults in on first use during trading.
+        bool prefault_ = true;
+
+        auto operator==(const HugePageConfig &) const noexcept -> bool = default;
+    };
+
+    /// Length actually mapped for a request of bytes, deallocation needs the same value.
+    inline auto hugePageMappedBytes(size_t bytes, const HugePageConfig &config) noexcept {
+        const auto page_bytes = hugePageBytes(config.page_size_);
+        return (bytes + page_bytes - 1) / page_bytes * page_bytes;
+    }
+
+    /// Maps bytes with explicit hugepages (MAP_HUGETLB) if configured and available, otherwise with regular pages and
+    /// an madvise(MADV_HUGEPAGE) hint so transparent hugepages can back it.
+    inline auto hugePageAllocate(size_t bytes, const HugePageConfig &config) noexcept -> void * {
+        const auto mapped_bytes = hugePageMappedBytes(bytes, config);
+        const int populate = config.prefault_ ? MAP_POPULATE : 0;
+
+        void *ptr = MAP_FAILED;
+        if (config.page_size_ != HugePageSize::NONE) {
+            const int huge_flags = MAP_HUGETLB | ((config.page_size_ == HugePageSize::HUGE_1GB ? 30 : 21) << MAP_HUGE_SHIFT);
+            ptr = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | huge_flags | populate, -1, 0);
+        }
+
+        if (ptr == MAP_FAILED) {
+            ptr = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            ASSERT(ptr != MAP_FAILED, "mmap() of " + std::to_string(mapped_bytes) + " bytes failed. errno:" + std::string(strerror(errno)));
+
+            if (config.page_size_ != HugePageSize::NONE) {
+                madvise(ptr, mapped_bytes, MADV_HUGEPAGE);
+            }
+
+            // Populate after the madvise() so the faults are served with transparent hugepages where possible.
+            if (config.prefault_) {
+                for (size_t i = 0; i < mapped_bytes; i += SMALL_PAGE_BYTES) {
+                    static_cast<volatile char *>(ptr)[i] = 0;
+                }
+            }
+        }
+
+        if (config.lock_ && mlock(ptr, mapped_bytes) != 0) {
+            std::cerr << "mlock() of " << mapped_bytes << " bytes failed. errno:" << strerror(errno) << std::endl;
+        }
+
+        return ptr;
+    }
+
+    inline auto hugePageDeallocate(void *ptr, size_t bytes, const HugePageConfig &config) noexcept {
+        munmap(ptr, hugePageMappedBytes(bytes, config));
+    }
+
+    /// Standard allocator over hugePageAllocate(), meant for large long-lived buffers (queues, pools, socket buffers)
+    /// allocated once at startup - every allocation is its own mapping.
+    template<typename T>
+    class HugePageAllocator {
+    public:
+        using value_type = T;
+
+        HugePageConfig config_;
+
+        HugePageAllocator() noexcept = default;
+
+        explicit HugePageAllocator(const HugePageConfig &config) noexcept : config_(config) {}
+
+        template<typename U>
+        HugePageAllocator(const HugePageAllocator<U> &other) noexcept : config_(other.config_) {}
+
+        auto allocate(size_t n) noexcept -> T * {
+            return static_cast<T *>(hugePageAllocate(n * sizeof(T), config_));
+        }
+
+        auto deallocate(T *ptr, size_t n) noexcept {
+            hugePageDeallocate(ptr, n * sizeof(T), config_);
+        }
+
+        template<typename U>
+        auto operator==(const HugePageAllocator<U> &other) const noexcept {
+            return config_ == other.config_;
+        }
+    };
+}
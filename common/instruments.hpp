@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "macros.hpp"
+#include "types.hpp"
+
+namespace Common {
+    /// Tickers configured when no instrument file is given.
+    constexpr size_t ME_DEFAULT_NUM_TICKERS = 8;
+
+    /// Instrument of every ticker id, tickers without one are not traded and get no book.
+    typedef std::array<std::optional<InstrumentConfig>, ME_MAX_TICKERS> InstrumentConfigs;
+
+    /// The first ME_DEFAULT_NUM_TICKERS tickers with the default InstrumentConfig.
+    inline auto defaultInstrumentConfigs() {
+        InstrumentConfigs instrument_configs;
+        for (TickerId ticker_id = 0; ticker_id < ME_DEFAULT_NUM_TICKERS; ++ticker_id) {
+            instrument_configs[ticker_id] = InstrumentConfig();
+        }
+        return instrument_configs;
+    }
+
+    /// Reads one instrument per line, as "ticker_id base_price tick_size num_price_levels max_orders". Blank lines and lines
+    /// starting with # are skipped.
+    inline auto loadInstrumentConfigs(const std::string& file_name) {
+        std::ifstream file(file_name);
+        ASSERT(file.is_open(), "Failed to open instrument file:" + file_name);
+
+        InstrumentConfigs instrument_configs;
+        std::string line;
+        for (size_t line_num = 1; std::getline(file, line); ++line_num) {
+            const auto first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+
+            const auto where = file_name + ":" + std::to_string(line_num);
+            std::istringstream ss(line);
+            TickerId ticker_id = TickerId_INVALID;
+            InstrumentConfig config;
+            std::string extra;
+            ASSERT((ss >> ticker_id >> config.base_price_ >> config.tick_size_ >> config.num_price_levels_ >> config.max_orders_) && !(ss >> extra),
+                   "Malformed instrument at " + where + ":" + line);
+            ASSERT(ticker_id < ME_MAX_TICKERS, "Ticker out of range at " + where + ":" + tickerIdToString(ticker_id));
+            ASSERT(!instrument_configs[ticker_id], "Duplicate ticker at " + where + ":" + tickerIdToString(ticker_id));
+            ASSERT(config.tick_size_ > 0 && config.num_price_levels_ > 0 && config.max_orders_ > 0, "Empty instrument at " + where + ":" + line);
+
+            instrument_configs[ticker_id] = config;
+        }
+
+        return instrument_configs;
+    }
+}
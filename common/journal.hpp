@@ -0,0 +1,307 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huge_page_allocator.hpp"
+#include "macros.hpp"
+#include "thread_utils.hpp"
+#include "time_utils.hpp"
+
+namespace Common {
+    constexpr uint64_t JOURNAL_MAGIC = 0x4c4e524a4c4c4c4cull;    // "LLLLJRNL"
+    constexpr uint32_t JOURNAL_VERSION = 1;
+
+    /// Records start on the page after the header.
+    constexpr size_t JOURNAL_HEADER_BYTES = 4 * 1024;
+
+    /// Pages ahead of the write position the sync thread keeps faulted in.
+    constexpr size_t JOURNAL_PREFAULT_BYTES = 4 * 1024 * 1024;
+
+    struct JournalHeader {
+        uint64_t magic_ = JOURNAL_MAGIC;
+        uint32_t version_ = JOURNAL_VERSION;
+        uint32_t record_size_ = 0;
+        uint64_t capacity_ = 0;
+
+        // Records below this are complete, stored after the record itself.
+        std::atomic<uint64_t> num_records_ = {0};
+
+        // Index the first record of the file has in the whole journal, the ones before it were left in older segments by
+        // JournalWriter::startSegment(). Appended after num_records_, so it reads 0 in journals written before segments.
+        uint64_t first_index_ = 0;
+    };
+
+    static_assert(sizeof(JournalHeader) <= JOURNAL_HEADER_BYTES);
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    /// Validates the header of a mapped journal against the record type.
+    inline auto checkJournalHeader(const JournalHeader *header, size_t record_size, size_t file_bytes, const std::string &path) noexcept {
+        ASSERT(header->magic_ == JOURNAL_MAGIC && header->version_ == JOURNAL_VERSION, "Not a journal file:" + path);
+        ASSERT(header->record_size_ == record_size, "Journal " + path + " has record size:" + std::to_string(header->record_size_) +
+               " expected:" + std::to_string(record_size));
+        ASSERT(JOURNAL_HEADER_BYTES + header->capacity_ * record_size <= file_bytes, "Journal file truncated:" + path);
+    }
+
+    /// Append-only journal of fixed size records in a memory mapped file, created with room for capacity records (the file
+    /// is sparse until written). append() is a memcpy and a release store of the record count - it never makes a system
+    /// call. A background thread msync()s what has been appended every sync_interval and keeps the pages ahead of the write
+    /// position faulted in. Opening an existing journal continues after its last complete record. startSegment() lets a
+    /// journal run forever in a fixed capacity, by dropping the records at its start nobody needs any more.
+    template<typename T>
+    class JournalWriter final {
+    private:
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        const std::string path_;
+        int fd_ = -1;
+        size_t mapped_bytes_ = 0;
+        char *base_ = nullptr;
+        JournalHeader *header_ = nullptr;
+        T *records_ = nullptr;
+
+        size_t capacity_ = 0;
+        size_t first_index_ = 0;
+        size_t next_index_ = 0;
+
+        const Nanos sync_interval_ = 0;
+        volatile bool running_ = true;
+        std::thread *sync_thread_ = nullptr;
+        size_t synced_index_ = 0;
+        size_t prefaulted_bytes_ = 0;
+
+        auto recordOffset(size_t index) const noexcept {
+            return JOURNAL_HEADER_BYTES + index * sizeof(T);
+        }
+
+        void sync(size_t num_records) noexcept {
+            if (num_records > synced_index_) {
+                const auto begin = recordOffset(synced_index_) / SMALL_PAGE_BYTES * SMALL_PAGE_BYTES;
+                msync(base_ + begin, recordOffset(num_records) - begin, MS_SYNC);
+                msync(base_, JOURNAL_HEADER_BYTES, MS_SYNC);
+                synced_index_ = num_records;
+            }
+        }
+
+        void prefault(size_t num_records) noexcept {
+#ifdef MADV_POPULATE_WRITE
+            // Populates the page tables as if written without modifying anything, so it is safe next to the writer.
+            const auto end = std::min(mapped_bytes_, recordOffset(num_records) + JOURNAL_PREFAULT_BYTES);
+            if (end > prefaulted_bytes_) {
+                madvise(base_ + prefaulted_bytes_, end - prefaulted_bytes_, MADV_POPULATE_WRITE);
+                prefaulted_bytes_ = end;
+            }
+#else
+            (void) num_records;
+#endif
+        }
+
+        void runSync() noexcept {
+            while (running_) {
+                const auto num_records = header_->num_records_.load(std::memory_order_acquire);
+                sync(num_records);
+                prefault(num_records);
+                std::this_thread::sleep_for(std::chrono::nanoseconds(sync_interval_));
+            }
+        }
+
+        void startSync() noexcept {
+            running_ = true;
+            sync_thread_ = createAndStartThread(-1, "Common/JournalWriter " + path_, [this]() { runSync(); });
+            ASSERT(sync_thread_ != nullptr, "Failed to start JournalWriter sync thread for:" + path_);
+        }
+
+        void stopSync() noexcept {
+            running_ = false;
+            sync_thread_->join();
+            delete sync_thread_;
+            sync_thread_ = nullptr;
+
+            sync(next_index_);
+        }
+
+    public:
+        JournalWriter(const std::string &path, size_t capacity, Nanos sync_interval) : path_(path), sync_interval_(sync_interval) {
+            fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            ASSERT(fd_ >= 0, "Unable to open journal:" + path + " errno:" + std::string(strerror(errno)));
+
+            struct stat st;
+            ASSERT(fstat(fd_, &st) == 0, "Unable to stat journal:" + path + " errno:" + std::string(strerror(errno)));
+            const bool is_new = (st.st_size == 0);
+
+            if (is_new) {
+                mapped_bytes_ = JOURNAL_HEADER_BYTES + capacity * sizeof(T);
+                ASSERT(ftruncate(fd_, static_cast<off_t>(mapped_bytes_)) == 0, "Unable to size journal:" + path + " errno:" +
+                       std::string(strerror(errno)));
+            } else {
+                mapped_bytes_ = static_cast<size_t>(st.st_size);
+            }
+
+            base_ = static_cast<char *>(mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0));
+            ASSERT(base_ != MAP_FAILED, "Unable to mmap journal:" + path + " errno:" + std::string(strerror(errno)));
+            header_ = reinterpret_cast<JournalHeader *>(base_);
+            records_ = reinterpret_cast<T *>(base_ + JOURNAL_HEADER_BYTES);
+
+            if (is_new) {
+                new(header_) JournalHeader();
+                header_->record_size_ = sizeof(T);
+                header_->capacity_ = capacity;
+            }
+            checkJournalHeader(header_, sizeof(T), mapped_bytes_, path);
+
+            capacity_ = header_->capacity_;
+            first_index_ = header_->first_index_;
+            next_index_ = synced_index_ = header_->num_records_.load(std::memory_order_acquire);
+            prefaulted_bytes_ = recordOffset(next_index_) / SMALL_PAGE_BYTES * SMALL_PAGE_BYTES;
+            prefault(next_index_);
+
+            startSync();
+        }
+
+        ~JournalWriter() {
+            stopSync();
+            munmap(base_, mapped_bytes_);
+            close(fd_);
+        }
+
+        /// Callers check size() against capacity() first, a full journal is a bug.
+        void append(const T &record) noexcept {
+            ASSERT(next_index_ < capacity_, "Journal full:" + path_ + " capacity:" + std::to_string(capacity_));
+            memcpy(static_cast<void *>(&records_[next_index_]), &record, sizeof(T));
+            header_->num_records_.store(++next_index_, std::memory_order_release);
+        }
+
+        /// Replaces the file with a new segment holding only the records from journal index first_index on, with the full
+        /// capacity again minus those. The current file is kept as path.<its first index>, and the new one renamed over it,
+        /// so a crash leaves either the old or the new segment in place. Stalls the caller for a copy of the records kept
+        /// and a few system calls.
+        void startSegment(size_t first_index) noexcept {
+            ASSERT(first_index >= first_index_ && first_index <= first_index_ + next_index_, "Segment start:" + std::to_string(first_index) +
+                   " outside of journal:" + path_ + " records:" + std::to_string(first_index_) + "-" + std::to_string(first_index_ + next_index_));
+            stopSync();
+
+            const auto tmp_path = path_ + ".tmp";
+            const int fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            ASSERT(fd >= 0, "Unable to open journal:" + tmp_path + " errno:" + std::string(strerror(errno)));
+            const auto mapped_bytes = JOURNAL_HEADER_BYTES + capacity_ * sizeof(T);
+            ASSERT(ftruncate(fd, static_cast<off_t>(mapped_bytes)) == 0, "Unable to size journal:" + tmp_path + " errno:" +
+                   std::string(strerror(errno)));
+            const auto base = static_cast<char *>(mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+            ASSERT(base != MAP_FAILED, "Unable to mmap journal:" + tmp_path + " errno:" + std::string(strerror(errno)));
+
+            const auto header = new(base) JournalHeader();
+            header->record_size_ = sizeof(T);
+            header->capacity_ = capacity_;
+            header->first_index_ = first_index;
+            const auto num_records = first_index_ + next_index_ - first_index;
+            memcpy(base + JOURNAL_HEADER_BYTES, static_cast<const void *>(&records_[first_index - first_index_]), num_records * sizeof(T));
+            header->num_records_.store(num_records, std::memory_order_release);
+            ASSERT(msync(base, JOURNAL_HEADER_BYTES + num_records * sizeof(T), MS_SYNC) == 0, "Failed to sync journal:" + tmp_path +
+                   " errno:" + std::string(strerror(errno)));
+
+            const auto old_path = path_ + "." + std::to_string(first_index_);
+            unlink(old_path.c_str());   // left behind by a crash between the link and the rename.
+            ASSERT(link(path_.c_str(), old_path.c_str()) == 0, "Unable to keep journal segment:" + old_path + " errno:" + std::string(strerror(errno)));
+            ASSERT(rename(tmp_path.c_str(), path_.c_str()) == 0, "Failed to rename journal:" + tmp_path + " errno:" + std::string(strerror(errno)));
+
+            munmap(base_, mapped_bytes_);
+            close(fd_);
+            fd_ = fd;
+            mapped_bytes_ = mapped_bytes;
+            base_ = base;
+            header_ = header;
+            records_ = reinterpret_cast<T *>(base_ + JOURNAL_HEADER_BYTES);
+            first_index_ = first_index;
+            next_index_ = synced_index_ = num_records;
+            prefaulted_bytes_ = recordOffset(next_index_) / SMALL_PAGE_BYTES * SMALL_PAGE_BYTES;
+            prefault(next_index_);
+
+            startSync();
+        }
+
+        /// Complete records of the current segment, including the ones found when an existing journal was opened.
+        auto records() const noexcept {
+            return std::span<const T>(records_, next_index_);
+        }
+
+        /// Journal index of records().front().
+        auto firstIndex() const noexcept {
+            return first_index_;
+        }
+
+        auto size() const noexcept {
+            return next_index_;
+        }
+
+        auto capacity() const noexcept {
+            return capacity_;
+        }
+
+        JournalWriter() = delete;
+        JournalWriter(const JournalWriter&) = delete;
+        JournalWriter(const JournalWriter&&) = delete;
+        JournalWriter& operator=(const JournalWriter&) = delete;
+        JournalWriter& operator=(const JournalWriter&&) = delete;
+    };
+
+    /// Read-only view of the complete records of a journal written by JournalWriter.
+    template<typename T>
+    class JournalReader final {
+    private:
+        int fd_ = -1;
+        size_t mapped_bytes_ = 0;
+        char *base_ = nullptr;
+        std::span<const T> records_;
+        size_t first_index_ = 0;
+
+    public:
+        explicit JournalReader(const std::string &path) {
+            fd_ = open(path.c_str(), O_RDONLY);
+            ASSERT(fd_ >= 0, "Unable to open journal:" + path + " errno:" + std::string(strerror(errno)));
+
+            struct stat st;
+            ASSERT(fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) >= JOURNAL_HEADER_BYTES, "Not a journal file:" + path);
+            mapped_bytes_ = static_cast<size_t>(st.st_size);
+
+            base_ = static_cast<char *>(mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd_, 0));
+            ASSERT(base_ != MAP_FAILED, "Unable to mmap journal:" + path + " errno:" + std::string(strerror(errno)));
+
+            const auto header = reinterpret_cast<const JournalHeader *>(base_);
+            checkJournalHeader(header, sizeof(T), mapped_bytes_, path);
+            records_ = {reinterpret_cast<const T *>(base_ + JOURNAL_HEADER_BYTES), header->num_records_.load(std::memory_order_acquire)};
+            first_index_ = header->first_index_;
+        }
+
+        ~JournalReader() {
+            munmap(base_, mapped_bytes_);
+            close(fd_);
+        }
+
+        auto records() const noexcept {
+            return records_;
+        }
+
+        /// Journal index of records().front(), see JournalWriter::startSegment().
+        auto firstIndex() const noexcept {
+            return first_index_;
+        }
+
+        JournalReader() = delete;
+        JournalReader(const JournalReader&) = delete;
+        JournalReader(const JournalReader&&) = delete;
+        JournalReader& operator=(const JournalReader&) = delete;
+        JournalReader& operator=(const JournalReader&&) = delete;
+    };
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "macros.hpp"
+
+namespace Common {
+    /// Occupancy bitmap over up to 64^3 levels, as three levels of 64 bit words - a bit in a summary word is set when the
+    /// word below it is non-zero. Set / clear touch at most three words, the first / last / next / previous set level is
+    /// found with one countr_zero / countl_zero per level.
+    class LevelBitmap final {
+    private:
+        static constexpr size_t WORD_BITS = 64;
+        static constexpr size_t WORD_SHIFT = 6;
+
+        std::vector<uint64_t> leaves_;
+        std::vector<uint64_t> mids_;
+        uint64_t top_ = 0;
+
+        static constexpr auto bit(size_t index) noexcept -> uint64_t {
+            return uint64_t{1} << (index & (WORD_BITS - 1));
+        }
+
+        // Bits strictly above / below index within its word.
+        static constexpr auto maskAbove(size_t index) noexcept -> uint64_t {
+            return (index & (WORD_BITS - 1)) == WORD_BITS - 1 ? 0 : ~uint64_t{0} << ((index & (WORD_BITS - 1)) + 1);
+        }
+
+        static constexpr auto maskBelow(size_t index) noexcept -> uint64_t {
+            return bit(index) - 1;
+        }
+
+        auto firstInMid(size_t mid) const noexcept {
+            const auto leaf = (mid << WORD_SHIFT) + std::countr_zero(mids_[mid]);
+            return (leaf << WORD_SHIFT) + std::countr_zero(leaves_[leaf]);
+        }
+
+        auto lastInMid(size_t mid) const noexcept {
+            const auto leaf = (mid << WORD_SHIFT) + (WORD_BITS - 1 - std::countl_zero(mids_[mid]));
+            return (leaf << WORD_SHIFT) + (WORD_BITS - 1 - std::countl_zero(leaves_[leaf]));
+        }
+
+    public:
+        static constexpr size_t NPOS = std::numeric_limits<size_t>::max();
+        static constexpr size_t MAX_LEVELS = WORD_BITS * WORD_BITS * WORD_BITS;
+
+        explicit LevelBitmap(size_t num_levels) : leaves_((num_levels + WORD_BITS - 1) >> WORD_SHIFT, 0),
+                mids_((leaves_.size() + WORD_BITS - 1) >> WORD_SHIFT, 0) {
+            ASSERT(num_levels <= MAX_LEVELS, "LevelBitmap supports at most " + std::to_string(MAX_LEVELS) + " levels, requested:" +
+                   std::to_string(num_levels));
+        }
+
+        auto test(size_t index) const noexcept {
+            return (leaves_[index >> WORD_SHIFT] & bit(index)) != 0;
+        }
+
+        auto empty() const noexcept {
+            return top_ == 0;
+        }
+
+        auto set(size_t index) noexcept {
+            leaves_[index >> WORD_SHIFT] |= bit(index);
+            mids_[index >> (2 * WORD_SHIFT)] |= bit(index >> WORD_SHIFT);
+            top_ |= bit(index >> (2 * WORD_SHIFT));
+        }
+
+        auto clear(size_t index) noexcept {
+            auto &leaf = leaves_[index >> WORD_SHIFT];
+            leaf &= ~bit(index);
+            if (leaf == 0) {
+                auto &mid = mids_[index >> (2 * WORD_SHIFT)];
+                mid &= ~bit(index >> WORD_SHIFT);
+                if (mid == 0) {
+                    top_ &= ~bit(index >> (2 * WORD_SHIFT));
+                }
+            }
+        }
+
+        /// Lowest set level or NPOS.
+        auto findFirst() const noexcept -> size_t {
+            return top_ ? firstInMid(std::countr_zero(top_)) : NPOS;
+        }
+
+        /// Highest set level or NPOS.
+        auto findLast() const noexcept -> size_t {
+            return top_ ? lastInMid(WORD_BITS - 1 - std::countl_zero(top_)) : NPOS;
+        }
+
+        /// Lowest set level strictly above index or NPOS.
+        auto findNext(size_t index) const noexcept -> size_t {
+            const auto leaf = index >> WORD_SHIFT, mid = index >> (2 * WORD_SHIFT);
+
+            if (const auto word = leaves_[leaf] & maskAbove(index)) {
+                return (leaf << WORD_SHIFT) + std::countr_zero(word);
+            }
+            if (const auto word = mids_[mid] & maskAbove(leaf)) {
+                const auto next_leaf = (mid << WORD_SHIFT) + std::countr_zero(word);
+                return (next_leaf << WORD_SHIFT) + std::countr_zero(leaves_[next_leaf]);
+            }
+            if (const auto word = top_ & maskAbove(mid)) {
+                return firstInMid(std::countr_zero(word));
+            }
+            return NPOS;
+        }
+
+        /// Highest set level strictly below index or NPOS.
+        auto findPrev(size_t index) const noexcept -> size_t {
+            const auto leaf = index >> WORD_SHIFT, mid = index >> (2 * WORD_SHIFT);
+
+            if (const auto word = leaves_[leaf] & maskBelow(index)) {
+                return (leaf << WORD_SHIFT) + (WORD_BITS - 1 - std::countl_zero(word));
+            }
+            if (const auto word = mids_[mid] & maskBelow(leaf)) {
+                const auto prev_leaf = (mid << WORD_SHIFT) + (WORD_BITS - 1 - std::countl_zero(word));
+                return (prev_leaf << WORD_SHIFT) + (WORD_BITS - 1 - std::countl_zero(leaves_[prev_leaf]));
+            }
+            if (const auto word = top_ & maskBelow(mid)) {
+                return lastInMid(WORD_BITS - 1 - std::countl_zero(word));
+            }
+            return NPOS;
+        }
+
+        LevelBitmap() = delete;
+        LevelBitmap(const LevelBitmap&) = delete;
+        LevelBitmap(const LevelBitmap&&) = delete;
+        LevelBitmap& operator=(const LevelBitmap&) = delete;
+        LevelBitmap& operator=(const LevelBitmap&&) = delete;
+    };
+}
@@ -3,25 +3,38 @@
 
 #include <cassert>
 #include <atomic>
+#include <algorithm>
+#include <span>
+#include <utility>
 #include <vector>
 
 #include "macros.hpp"
 
 namespace Common {
-    template<typename T, typename Alloc = std::allocator<T>>
+    enum class LFQueueLayout : uint8_t {
+        COMPACT = 0,
+        PADDED = 1
+    };
+
+    template<typename T, typename Alloc = std::allocator<T>, LFQueueLayout Layout = LFQueueLayout::PADDED>
     class LFQueue final : private Alloc {
     private:
         using allocator_traits = std::allocator_traits<Alloc>;
         using size_type = typename allocator_traits::size_type;
 
-        size_type mask_ = 0;
+        // PADDED puts the read-only fields, the consumer owned fields and the producer owned fields on separate cache lines,
+        // so the threads only share a line when one of them refreshes its cached copy of the other's index.
+        static constexpr size_t field_alignment_ = (Layout == LFQueueLayout::PADDED) ? CACHE_LINE_SIZE : alignof(std::atomic<size_type>);
 
+        alignas(field_alignment_) size_type mask_ = 0;
         T* store_;
-        std::atomic<size_type> next_read_index_ = {0};
-        std::atomic<size_type> next_write_index_ = {0};
-        size_type next_read_index_cached_ = 0;
+
+        alignas(field_alignment_) std::atomic<size_type> next_read_index_ = {0};
         size_type next_write_index_cached_ = 0;
 
+        alignas(field_alignment_) std::atomic<size_type> next_write_index_ = {0};
+        size_type next_read_index_cached_ = 0;
+
         static_assert(std::atomic<size_type>::is_always_lock_free);
 
     public:
@@ -49,6 +62,63 @@ namespace Common {
             return true;
         }
 
+        /// Constructs the element directly in the ring.
+        template<typename... Args>
+        bool emplace(Args&&... args) {
+            auto next_write_index = next_write_index_.load(std::memory_order_relaxed);
+            if (full(next_write_index, next_read_index_cached_)) {
+                next_read_index_cached_ = next_read_index_.load(std::memory_order_acquire);
+
+                if (full(next_write_index, next_read_index_cached_)) return false;
+            }
+
+            new(element(next_write_index)) T(std::forward<Args>(args)...);
+            next_write_index_.store(next_write_index + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Up to n free slots after the current write position, fewer if the queue is close to full or the ring wraps around.
+        /// Slots are uninitialized storage, construct elements with placement new and then publish them with commitWrite().
+        std::span<T> tryClaimWrite(size_type n) noexcept {
+            const auto next_write_index = next_write_index_.load(std::memory_order_relaxed);
+            if (capacity() - (next_write_index - next_read_index_cached_) < n) {
+                next_read_index_cached_ = next_read_index_.load(std::memory_order_acquire);
+            }
+
+            const auto available = std::min({n, capacity() - (next_write_index - next_read_index_cached_),
+                                              capacity() - (next_write_index & mask_)});
+            return {element(next_write_index), available};
+        }
+
+        /// Publishes the first n elements constructed in the last tryClaimWrite() span with a single store.
+        void commitWrite(size_type n) noexcept {
+            const auto next_write_index = next_write_index_.load(std::memory_order_relaxed);
+            HOT_ASSERT(next_write_index + n - next_read_index_cached_ <= capacity(), "LFQueue commitWrite() past claimed slots.");
+            next_write_index_.store(next_write_index + n, std::memory_order_release);
+        }
+
+        /// Up to n readable elements after the current read position, fewer if that many are not available or the ring wraps
+        /// around. Elements stay in the queue until releaseRead().
+        std::span<T> peekRead(size_type n) noexcept {
+            const auto next_read_index = next_read_index_.load(std::memory_order_relaxed);
+            if (next_write_index_cached_ - next_read_index < n) {
+                next_write_index_cached_ = next_write_index_.load(std::memory_order_acquire);
+            }
+
+            const auto available = std::min({n, next_write_index_cached_ - next_read_index, capacity() - (next_read_index & mask_)});
+            return {element(next_read_index), available};
+        }
+
+        /// Destroys the first n elements of the last peekRead() span and frees their slots with a single store.
+        void releaseRead(size_type n) noexcept {
+            const auto next_read_index = next_read_index_.load(std::memory_order_relaxed);
+            HOT_ASSERT(next_read_index + n <= next_write_index_cached_, "LFQueue releaseRead() past peeked elements.");
+            for (size_type i = 0; i < n; ++i) {
+                element(next_read_index + i)->~T();
+            }
+            next_read_index_.store(next_read_index + n, std::memory_order_release);
+        }
+
         bool pop(T& value) {
             auto next_read_index = next_read_index_.load(std::memory_order_relaxed);
             if (empty(next_write_index_cached_, next_read_index)) {
@@ -64,7 +134,7 @@ namespace Common {
         }
 
         auto size() const noexcept {
-            ASSERT(next_read_index_ <= next_write_index_, "Invalid LFQueue pointers in:" + std::to_string(pthread_self()));
+            HOT_ASSERT(next_read_index_ <= next_write_index_, "Invalid LFQueue pointers in:" + std::to_string(pthread_self()));
             return next_write_index_ - next_read_index_;
         }
 
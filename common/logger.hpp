@@ -1,15 +1,23 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <fstream>
+#include <span>
 #include <atomic>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include "lf_queue.hpp"
+#include "huge_page_allocator.hpp"
 #include "macros.hpp"
 #include "thread_utils.hpp"
 #include "time_utils.hpp"
 
 namespace Common {
-    constexpr size_t LOG_QUEUE_SIZE = 8 * 1024 * 1024;
+    constexpr size_t LOG_BLOCK_SIZE = 64;
+    constexpr size_t LOG_QUEUE_SIZE = 2 * 1024 * 1024;     // in LogBlocks, i.e. 128MB of queued log data
 
     enum class LogType : int8_t {
         CHAR = 0,
@@ -20,74 +28,210 @@ namespace Common {
         UNSIGNED_LONG_INTEGER = 5,
         UNSIGNED_LONG_LONG_INTEGER = 6,
         FLOAT = 7,
-        DOUBLE = 8
+        DOUBLE = 8,
+        STRING = 9,
+        TIMESTAMP = 10
     };
 
-    struct LogElement {
-        LogType type_ = LogType::CHAR;
-        union {
-            char c;
-            int i;
-            long l;
-            long long ll;
-            unsigned u;
-            unsigned long ul;
-            unsigned long long ull;
-            float f;
-            double d;      
-        } data_;
+    // TEXT: the logger thread formats records into a readable log file.
+    // BINARY: the logger thread writes raw records, to be formatted offline by common/tools/log_decoder.
+    enum class LogMode : uint8_t {
+        TEXT = 0,
+        BINARY = 1
     };
 
+    /// A log record is a LogRecordHeader followed by header.size_ bytes of encoded arguments.
+    /// Each argument is encoded as its LogType followed by its raw bytes (strings are length-prefixed).
+    /// Records start on a LogBlock boundary and span as many consecutive LogBlocks as needed.
+    struct LogRecordHeader {
+        const char* format_ = nullptr;
+        uint32_t size_ = 0;
+    };
+
+    struct alignas(LOG_BLOCK_SIZE) LogBlock {
+        char data_[LOG_BLOCK_SIZE];
+    };
+
+    /// Binary log file layout: LOG_BINARY_MAGIC followed by a stream of entries, each starting with a LogBinaryEntry.
+    /// FORMAT: uint32 id, uint32 length, format string bytes - written the first time a format string is seen.
+    /// RECORD: uint32 format id, uint32 size, encoded arguments.
+    /// CALIBRATION: uint32 0, uint32 size, TSCCalibration used for the TIMESTAMP arguments of the records that follow.
+    constexpr char LOG_BINARY_MAGIC[8] = {'L', 'L', 'B', 'L', 'O', 'G', '0', '1'};
+
+    enum class LogBinaryEntry : uint8_t {
+        FORMAT = 1,
+        RECORD = 2,
+        CALIBRATION = 3
+    };
+
+    /// Format string checked at compile time against the number of arguments passed to Logger::log().
+    template<typename... A>
+    struct LogFormat {
+        const char* format_;
+
+        consteval LogFormat(const char* format) : format_(format) {
+            size_t num_args = 0;
+            for (auto s = format; *s; ++s) {
+                if (*s == '%') {
+                    if (*(s + 1) == '%') {
+                        ++s;
+                    }
+                    else {
+                        ++num_args;
+                    }
+                }
+            }
+            if (num_args != sizeof...(A)) {
+                throw "number of % in log format does not match number of arguments to log()";
+            }
+        }
+    };
+
+    // Maps every supported argument type onto the value which gets encoded into the log record.
+    inline auto logValue(const char value) noexcept { return value; }
+    inline auto logValue(const int value) noexcept { return value; }
+    inline auto logValue(const long value) noexcept { return value; }
+    inline auto logValue(const long long value) noexcept { return value; }
+    inline auto logValue(const unsigned value) noexcept { return value; }
+    inline auto logValue(const unsigned long value) noexcept { return value; }
+    inline auto logValue(const unsigned long long value) noexcept { return value; }
+    inline auto logValue(const float value) noexcept { return value; }
+    inline auto logValue(const double value) noexcept { return value; }
+    inline auto logValue(const char *value) noexcept { return std::string_view(value); }
+    inline auto logValue(const std::string &value) noexcept { return std::string_view(value); }
+    inline auto logValue(const Timestamp value) noexcept { return value; }
+
+    template<typename T>
+    constexpr LogType logTypeOf() noexcept {
+        if constexpr (std::is_same_v<T, char>) return LogType::CHAR;
+        else if constexpr (std::is_same_v<T, int>) return LogType::INTEGER;
+        else if constexpr (std::is_same_v<T, long>) return LogType::LONG_INTEGER;
+        else if constexpr (std::is_same_v<T, long long>) return LogType::LONG_LONG_INTEGER;
+        else if constexpr (std::is_same_v<T, unsigned>) return LogType::UNSIGNED_INTEGER;
+        else if constexpr (std::is_same_v<T, unsigned long>) return LogType::UNSIGNED_LONG_INTEGER;
+        else if constexpr (std::is_same_v<T, unsigned long long>) return LogType::UNSIGNED_LONG_LONG_INTEGER;
+        else if constexpr (std::is_same_v<T, float>) return LogType::FLOAT;
+        else if constexpr (std::is_same_v<T, double>) return LogType::DOUBLE;
+        else if constexpr (std::is_same_v<T, std::string_view>) return LogType::STRING;
+        else if constexpr (std::is_same_v<T, Timestamp>) return LogType::TIMESTAMP;
+    }
+
+    template<typename T>
+    constexpr size_t encodedSize(const T) noexcept {
+        return sizeof(LogType) + sizeof(T);
+    }
+
+    inline size_t encodedSize(const std::string_view value) noexcept {
+        return sizeof(LogType) + sizeof(uint32_t) + value.size();
+    }
+
+    /// Formats one record's encoded arguments into os as directed by format. Used by the logger thread and log_decoder.
+    inline auto formatLogRecord(std::ostream &os, const char *format, const char *args, size_t size, const TSCCalibration &calibration) noexcept {
+        const char *const args_end = args + size;
+
+        auto read = [&](auto &value) {
+            if (args + sizeof(value) > args_end) [[unlikely]] {
+                return false;
+            }
+            memcpy(&value, args, sizeof(value));
+            args += sizeof(value);
+            return true;
+        };
+
+        auto print_next_arg = [&]() {
+            LogType type;
+            if (!read(type)) [[unlikely]] {
+                return;
+            }
+            switch (type) {
+                case LogType::CHAR: { char v; if (read(v)) os << v; } break;
+                case LogType::INTEGER: { int v; if (read(v)) os << v; } break;
+                case LogType::LONG_INTEGER: { long v; if (read(v)) os << v; } break;
+                case LogType::LONG_LONG_INTEGER: { long long v; if (read(v)) os << v; } break;
+                case LogType::UNSIGNED_INTEGER: { unsigned v; if (read(v)) os << v; } break;
+                case LogType::UNSIGNED_LONG_INTEGER: { unsigned long v; if (read(v)) os << v; } break;
+                case LogType::UNSIGNED_LONG_LONG_INTEGER: { unsigned long long v; if (read(v)) os << v; } break;
+                case LogType::FLOAT: { float v; if (read(v)) os << v; } break;
+                case LogType::DOUBLE: { double v; if (read(v)) os << v; } break;
+                case LogType::TIMESTAMP: {
+                    static thread_local std::string time_str;
+                    Timestamp v;
+                    if (read(v)) os << nanosToTimeStr(calibration.toNanos(v.ticks_), &time_str);
+                }
+                break;
+                case LogType::STRING: {
+                    uint32_t length;
+                    if (read(length) && args + length <= args_end) {
+                        os.write(args, length);
+                        args += length;
+                    }
+                }
+                break;
+            }
+        };
+
+        for (auto s = format; *s; ++s) {
+            if (*s == '%') {
+                if (*(s + 1) == '%') [[unlikely]] {
+                    ++s;
+                }
+                else {
+                    print_next_arg();
+                    continue;
+                }
+            }
+            os << *s;
+        }
+    }
+
     class Logger final {
     private:
         const std::string file_name_;
+        const LogMode mode_;
         std::ofstream file_;
-        LFQueue<LogElement> log_queue_;
+        LFQueue<LogBlock, HugePageAllocator<LogBlock>> log_queue_;
         std::thread* logger_thread_ = nullptr;
         std::atomic<bool> running_ = {true};
 
-        LogElement log_element_;
+        // Producer side - blocks claimed in the queue for the record being written, published when it is complete.
+        std::span<LogBlock> claimed_blocks_;
+        size_t claimed_used_ = 0;
+        size_t record_blocks_left_ = 0;
+        LogBlock *pending_block_ = nullptr;
+        size_t pending_size_ = 0;
+
+        // Consumer side - the record being re-assembled from the queue.
+        std::vector<char> record_;
+        size_t record_size_ = 0;
+        std::unordered_map<const char*, uint32_t> format_ids_;
+        TSCCalibration calibration_;
+        uint64_t calibration_version_ = 0;
 
     public:
-        explicit Logger(const std::string& file_name) : file_name_(file_name), log_queue_(LOG_QUEUE_SIZE) {
-            file_.open(file_name);
+        explicit Logger(const std::string& file_name, LogMode mode = LogMode::TEXT)
+            : file_name_(file_name), mode_(mode), log_queue_(LOG_QUEUE_SIZE) {
+            file_.open(file_name, mode_ == LogMode::BINARY ? std::ios::out | std::ios::binary : std::ios::out);
             ASSERT(file_.is_open(), "Failed to open log file: " + file_name);
+            if (mode_ == LogMode::BINARY) {
+                file_.write(LOG_BINARY_MAGIC, sizeof(LOG_BINARY_MAGIC));
+            }
+            TSCClock::instance();   // initial calibration happens here and not on the first hot path conversion.
             logger_thread_ = createAndStartThread(-1, "Logger for " + file_name, [this](){ flushQueue(); });
             ASSERT(logger_thread_ != nullptr, "Could not start Logger thread");
         }
 
         void flushQueue() noexcept {
             while(running_) {
-                while (log_queue_.size() && log_queue_.pop(log_element_)) {
-                    switch (log_element_.type_) {
-                        case LogType::CHAR:
-                            file_ << log_element_.data_.c;
-                        break;
-                        case LogType::INTEGER:
-                            file_ << log_element_.data_.i;
-                        break;
-                        case LogType::LONG_INTEGER:
-                            file_ << log_element_.data_.l;
-                        break;
-                        case LogType::LONG_LONG_INTEGER:
-                            file_ << log_element_.data_.ll;
-                        break;
-                        case LogType::UNSIGNED_INTEGER:
-                            file_ << log_element_.data_.u;
-                        break;
-                        case LogType::UNSIGNED_LONG_INTEGER:
-                            file_ << log_element_.data_.ul;
-                        break;
-                        case LogType::UNSIGNED_LONG_LONG_INTEGER:
-                            file_ << log_element_.data_.ull;
-                        break;
-                        case LogType::FLOAT:
-                            file_ << log_element_.data_.f;
-                        break;
-                        case LogType::DOUBLE:
-                            file_ << log_element_.data_.d;
-                        break;
+                updateCalibration();
+
+                for (auto blocks = log_queue_.peekRead(log_queue_.capacity()); !blocks.empty();
+                     blocks = log_queue_.peekRead(log_queue_.capacity())) {
+                    for (const auto &block : blocks) {
+                        if (appendBlock(block)) {
+                            writeRecord();
+                        }
                     }
+                    log_queue_.releaseRead(blocks.size());
                 }
 
                 file_.flush();
@@ -112,94 +256,143 @@ namespace Common {
             std::cerr << Common::getCurrentTimeStr(&time_str) << " Logger for " << file_name_ << " exiting." << std::endl;
         }
 
-        auto pushValue(const LogElement &log_element) noexcept {
-            ASSERT(log_queue_.push(log_element), std::string("Logger for ") + file_name_ +  std::string(" attempted to push value to full LFQueue"));
-            // *(log_queue_.getNextToWrite()) = log_element;
-            // log_queue_.updateWriteIndex();
-        }
+        /// Encodes the arguments as raw bytes behind a pointer to the format string - all formatting is deferred to the logger thread.
+        template<typename... A>
+        auto log(LogFormat<std::type_identity_t<A>...> format, const A&... args) noexcept {
+            const auto values = std::make_tuple(logValue(args)...);
+            const auto size = std::apply([](const auto&... value) { return (size_t{0} + ... + encodedSize(value)); }, values);
 
-        auto pushValue(const char value) noexcept {
-            pushValue(LogElement{LogType::CHAR, {.c = value}});
-        }
+            const LogRecordHeader header{format.format_, static_cast<uint32_t>(size)};
+            record_blocks_left_ = (sizeof(header) + size + LOG_BLOCK_SIZE - 1) / LOG_BLOCK_SIZE;
+            write(&header, sizeof(header));
+            std::apply([this](const auto&... value) { (pushValue(value), ...); }, values);
 
-        auto pushValue(const int value) noexcept {
-            pushValue(LogElement{LogType::INTEGER, {.i = value}});
+            log_queue_.commitWrite(claimed_used_);
+            claimed_blocks_ = {};
+            claimed_used_ = 0;
+            pending_size_ = 0;
         }
 
-        auto pushValue(const long value) noexcept {
-            pushValue(LogElement{LogType::LONG_INTEGER, {.l = value}});
-        }
+        Logger(const Logger&) = delete;
+        Logger(const Logger&&) = delete;
+        Logger& operator=(const Logger&) = delete;
+        Logger& operator=(const Logger&&) = delete;
 
-        auto pushValue(const long long value) noexcept {
-            pushValue(LogElement{LogType::LONG_LONG_INTEGER, {.ll = value}});
-        }
+    private:
+        /// Moves on to the next claimed block, claiming the rest of the record's blocks when the current claim is used up.
+        /// A claim only falls short when the ring wraps around, the blocks so far are published before claiming again.
+        auto nextBlock() noexcept {
+            if (claimed_used_ == claimed_blocks_.size()) {
+                if (claimed_used_) {
+                    log_queue_.commitWrite(claimed_used_);
+                }
+                claimed_blocks_ = log_queue_.tryClaimWrite(record_blocks_left_);
+                claimed_used_ = 0;
+                ASSERT(!claimed_blocks_.empty(), std::string("Logger for ") + file_name_ +  std::string(" attempted to push value to full LFQueue"));
+            }
 
-        auto pushValue(const unsigned value) noexcept {
-            pushValue(LogElement{LogType::UNSIGNED_INTEGER, {.u = value}});
+            pending_block_ = new(&claimed_blocks_[claimed_used_++]) LogBlock;
+            pending_size_ = 0;
+            --record_blocks_left_;
         }
 
-        auto pushValue(const unsigned long value) noexcept {
-            pushValue(LogElement{LogType::UNSIGNED_LONG_INTEGER, {.ul = value}});
-        }
+        auto write(const void *data, size_t length) noexcept {
+            auto src = static_cast<const char*>(data);
+            while (length) {
+                if (pending_size_ == 0 || pending_size_ == LOG_BLOCK_SIZE) {
+                    nextBlock();
+                }
 
-        auto pushValue(const unsigned long long value) noexcept {
-            pushValue(LogElement{LogType::UNSIGNED_LONG_LONG_INTEGER, {.ull = value}});
+                const auto n = std::min(length, LOG_BLOCK_SIZE - pending_size_);
+                memcpy(pending_block_->data_ + pending_size_, src, n);
+                pending_size_ += n;
+                src += n;
+                length -= n;
+            }
         }
 
-        auto pushValue(const float value) noexcept {
-            pushValue(LogElement{LogType::FLOAT, {.f = value}});
+        template<typename T>
+        auto pushValue(const T value) noexcept {
+            constexpr auto type = logTypeOf<T>();
+            write(&type, sizeof(type));
+            write(&value, sizeof(value));
         }
 
-        auto pushValue(const double value) noexcept {
-            pushValue(LogElement{LogType::DOUBLE, {.d = value}});
+        auto pushValue(const std::string_view value) noexcept {
+            constexpr auto type = LogType::STRING;
+            const auto length = static_cast<uint32_t>(value.size());
+            write(&type, sizeof(type));
+            write(&length, sizeof(length));
+            write(value.data(), length);
         }
 
-        auto pushValue(const char *value) noexcept {
-            while (*value) {
-                pushValue(*value);
-                ++value;
+        /// Appends a LogBlock to the record being re-assembled in record_, returns true once the record is complete.
+        bool appendBlock(const LogBlock &block) noexcept {
+            if (record_size_ == 0) {
+                LogRecordHeader header;
+                memcpy(&header, block.data_, sizeof(header));
+                record_size_ = sizeof(header) + header.size_;
+                record_.clear();
             }
-        }
 
-        auto pushValue(const std::string &value) noexcept {
-            pushValue(value.c_str());
-        }
+            const auto n = std::min(LOG_BLOCK_SIZE, record_size_ - record_.size());
+            record_.insert(record_.end(), block.data_, block.data_ + n);
 
-        template<typename T, typename... A>
-        auto log(const char *s, const T &value, A... args) noexcept {
-            while (*s) {
-                if (*s == '%') {
-                    if (*(s + 1) == '%') [[unlikely]] {
-                        ++s;
-                    } 
-                    else {
-                        pushValue(value);
-                        log(s + 1, args...);
-                        return;
-                    }
-                }
-                pushValue(*s++);
+            if (record_.size() == record_size_) {
+                record_size_ = 0;
+                return true;
             }
-            FATAL("extra arguments provided to log()");
+
+            return false;
         }
 
-        auto log(const char *s) noexcept {
-            while (*s) {
-                if (*s == '%') {
-                    if (*(s + 1) == '%') [[unlikely]] {
-                        ++s;
-                    } 
-                    else {
-                        FATAL("missing arguments to log()");
-                    }
-                }
-                pushValue(*s++);
+        void updateCalibration() noexcept {
+            auto &tsc_clock = TSCClock::instance();
+            tsc_clock.calibrate();
+            if (tsc_clock.version() == calibration_version_) [[likely]] {
+                return;
+            }
+
+            calibration_version_ = tsc_clock.version();
+            calibration_ = tsc_clock.calibration();
+
+            if (mode_ == LogMode::BINARY) {
+                const auto entry = LogBinaryEntry::CALIBRATION;
+                const uint32_t id = 0, size = sizeof(calibration_);
+                file_.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+                file_.write(reinterpret_cast<const char*>(&id), sizeof(id));
+                file_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+                file_.write(reinterpret_cast<const char*>(&calibration_), size);
             }
         }
 
-        Logger(const Logger&) = delete;
-        Logger(const Logger&&) = delete;
-        Logger& operator=(const Logger&) = delete;
-        Logger& operator=(const Logger&&) = delete;
+        void writeRecord() noexcept {
+            LogRecordHeader header;
+            memcpy(&header, record_.data(), sizeof(header));
+            const char *args = record_.data() + sizeof(header);
+
+            if (mode_ == LogMode::TEXT) {
+                formatLogRecord(file_, header.format_, args, header.size_, calibration_);
+                return;
+            }
+
+            auto format_it = format_ids_.find(header.format_);
+            if (format_it == format_ids_.end()) [[unlikely]] {
+                format_it = format_ids_.emplace(header.format_, static_cast<uint32_t>(format_ids_.size())).first;
+
+                const auto entry = LogBinaryEntry::FORMAT;
+                const auto length = static_cast<uint32_t>(strlen(header.format_));
+                file_.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+                file_.write(reinterpret_cast<const char*>(&format_it->second), sizeof(format_it->second));
+                file_.write(reinterpret_cast<const char*>(&length), sizeof(length));
+                file_.write(header.format_, length);
+            }
+
+            const auto entry = LogBinaryEntry::RECORD;
+            file_.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+            file_.write(reinterpret_cast<const char*>(&format_it->second), sizeof(format_it->second));
+            file_.write(reinterpret_cast<const char*>(&header.size_), sizeof(header.size_));
+            file_.write(args, header.size_);
+        }
     };
-}
\ No newline at end of file
+}
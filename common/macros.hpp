@@ -2,17 +2,59 @@
 
 #include <cstring>
 #include <iostream>
+#include <string>
 
-inline auto ASSERT(bool cond, const std::string &msg) noexcept {
-  if (!cond) [[unlikely]] {
-    std::cerr << "ASSERT : " << msg << std::endl;
+inline constexpr size_t CACHE_LINE_SIZE = 64;
 
-    exit(EXIT_FAILURE);
+[[noreturn, gnu::cold, gnu::noinline]] inline void assertFailure(const char *type, const char *cond, const char *file, int line, const std::string &msg) noexcept {
+  std::cerr << type << " : " << msg;
+  if (cond) {
+    std::cerr << " [" << cond << "]";
   }
+  std::cerr << " at " << file << ":" << line << std::endl;
+
+  exit(EXIT_FAILURE);
 }
 
-inline auto FATAL(const std::string &msg) noexcept {
-  std::cerr << "FATAL : " << msg << std::endl;
+// Always-on fatal check. msg is only evaluated when cond fails, so building it can be as expensive as needed.
+#define ASSERT(cond, msg)                                                 \
+  do {                                                                    \
+    if (!(cond)) [[unlikely]] {                                           \
+      assertFailure("ASSERT", #cond, __FILE__, __LINE__, msg);            \
+    }                                                                     \
+  } while (false)
 
-  exit(EXIT_FAILURE);
-}
\ No newline at end of file
+#define FATAL(msg) assertFailure("FATAL", nullptr, __FILE__, __LINE__, msg)
+
+// Compiled out when NDEBUG is defined - cond must not have side effects.
+#ifdef NDEBUG
+#define DEBUG_ASSERT(cond, msg) do { (void) sizeof(cond); } while (false)
+#else
+#define DEBUG_ASSERT(cond, msg)                                           \
+  do {                                                                    \
+    if (!(cond)) [[unlikely]] {                                           \
+      assertFailure("DEBUG_ASSERT", #cond, __FILE__, __LINE__, msg);      \
+    }                                                                     \
+  } while (false)
+#endif
+
+// Sanity checks on per-message / per-order paths (queues, pools). Follow NDEBUG by default, build with
+// -DLL_HOT_ASSERTS=1 or 0 to turn them on in a release build or off in a debug build - cond must not have side effects.
+#ifndef LL_HOT_ASSERTS
+#ifdef NDEBUG
+#define LL_HOT_ASSERTS 0
+#else
+#define LL_HOT_ASSERTS 1
+#endif
+#endif
+
+#if LL_HOT_ASSERTS
+#define HOT_ASSERT(cond, msg)                                             \
+  do {                                                                    \
+    if (!(cond)) [[unlikely]] {                                           \
+      assertFailure("HOT_ASSERT", #cond, __FILE__, __LINE__, msg);        \
+    }                                                                     \
+  } while (false)
+#else
+#define HOT_ASSERT(cond, msg) do { (void) sizeof(cond); } while (false)
+#endif
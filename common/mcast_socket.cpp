@@ -25,7 +25,7 @@ namespace Common {
         const ssize_t n_rcv = recv(socket_fd_, inbound_data_.data() + next_rcv_valid_index_, MCastBufferSize - next_rcv_valid_index_, MSG_DONTWAIT);
         if (n_rcv > 0) {
             next_rcv_valid_index_ += n_rcv;
-            logger_.log("%:% %() % read socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), socket_fd_,
+            logger_.log("%:% %() % read socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), socket_fd_,
                         next_rcv_valid_index_);
             recv_callback_(this);
         }
@@ -34,7 +34,7 @@ namespace Common {
         if (next_send_valid_index_ > 0) {
             ssize_t n = ::send(socket_fd_, outbound_data_.data(), next_send_valid_index_, MSG_DONTWAIT | MSG_NOSIGNAL);
 
-            logger_.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), socket_fd_, n);
+            logger_.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), socket_fd_, n);
         }
         next_send_valid_index_ = 0;
 
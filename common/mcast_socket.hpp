@@ -10,9 +10,9 @@ namespace Common {
     constexpr size_t MCastBufferSize = 64 * 1024 * 1024;
 
     struct MCastSocket {
-        explicit MCastSocket(Logger &logger) : logger_(logger) {
-            outbound_data_.resize(MCastBufferSize);
-            inbound_data_.resize(MCastBufferSize);
+        explicit MCastSocket(Logger &logger, const HugePageConfig &buffer_config = HugePageConfig()) :
+                outbound_data_(MCastBufferSize, HugePageAllocator<char>(buffer_config)), inbound_data_(MCastBufferSize, HugePageAllocator<char>(buffer_config)),
+                logger_(logger) {
         }
 
         ~MCastSocket() {
@@ -34,14 +34,13 @@ namespace Common {
 
         int socket_fd_ = -1;
 
-        std::vector<char> outbound_data_;
+        SocketBuffer outbound_data_;
         size_t next_send_valid_index_ = 0;
-        std::vector<char> inbound_data_;
+        SocketBuffer inbound_data_;
         size_t next_rcv_valid_index_ = 0;
 
         std::function<void(MCastSocket* s)> recv_callback_ = nullptr;
 
-        std::string time_str_;
         Logger &logger_;
     };
 }
\ No newline at end of file
@@ -2,58 +2,73 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <utility>
+#include <memory>
 
 #include "macros.hpp"
 
 namespace Common {
-    template <typename T>
+    /// Fixed size object pool. Objects are stored densely, the in-use flags separately and free slots are tracked on a
+    /// stack of indices, so allocate() and deallocate() are O(1) regardless of how many objects are live.
+    template <typename T, typename Alloc = std::allocator<T>>
     class MemPool final {
     private:
-        class ObjectBlock {
-        public:
-            T object_;
-            bool is_free = true;
-        };
+        template<typename U>
+        using rebind_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
 
-        // Can use array instead of vector for small size pools
-        std::vector<ObjectBlock> store_;
-        std::size_t next_free_index_ = 0;
+        std::vector<T, Alloc> store_;
+        std::vector<bool, rebind_alloc<bool>> is_free_;
 
-        void updateNextFreeIndex() noexcept {
-            const auto initial_free_index = next_free_index_;
-            while (!store_[next_free_index_].is_free) {
-                ++next_free_index_;
-                if (next_free_index_ == store_.size()) [[unlikely]] {
-                    next_free_index_ = 0;
-                }
-                if (next_free_index_ == initial_free_index) [[unlikely]] {
-                    ASSERT(initial_free_index != next_free_index_, "Memory Pool out of space.");
-                }
-            }
-        }
+        // Top free_top_ entries are the free indices, lowest index is handed out first.
+        std::vector<uint32_t, rebind_alloc<uint32_t>> free_indices_;
+        std::size_t free_top_ = 0;
 
     public:
-        explicit MemPool (std::size_t size) : store_(size, { T(), true }) {
-            ASSERT(reinterpret_cast<const ObjectBlock *>(&(store_[0].object_)) == &(store_[0]), "T object should be first member of ObjectBlock.");
+        explicit MemPool (std::size_t size, const Alloc& alloc = Alloc()) : store_(size, T(), alloc), is_free_(size, true, alloc),
+                free_indices_(size, alloc), free_top_(size) {
+            ASSERT(size <= UINT32_MAX, "Memory Pool size too large:" + std::to_string(size));
+            for (std::size_t i = 0; i < size; ++i) {
+                free_indices_[i] = static_cast<uint32_t>(size - 1 - i);
+            }
         }
 
         template<typename... Args>
-        T* allocate(Args... args) noexcept {
-            auto obj_block = &(store_[next_free_index_]);
-            ASSERT(obj_block->is_free, "Expected free ObjectBlock at index:" + std::to_string(next_free_index_));
+        T* allocate(Args&&... args) noexcept {
+            ASSERT(free_top_ > 0, "Memory Pool out of space.");
+            const auto index = free_indices_[--free_top_];
+            HOT_ASSERT(is_free_[index], "Expected free object at index:" + std::to_string(index));
 
-            T* ret = &(obj_block->object_);
-            ret = new(ret) T(args...);  // placement new (doesn't allocate memory)
-            obj_block->is_free = false;
-            updateNextFreeIndex();
+            T* ret = &(store_[index]);
+            ret = new(ret) T(std::forward<Args>(args)...);  // placement new (doesn't allocate memory)
+            is_free_[index] = false;
             return ret;
         }
 
         auto deallocate(const T* elem) noexcept {
-            const auto elem_index = reinterpret_cast<const ObjectBlock*>(elem) - &(store_[0]);
+            const auto elem_index = elem - &(store_[0]);
+            // Always checked - pushing a foreign or already free index would overrun free_indices_ and hand a slot out twice.
             ASSERT(elem_index >= 0 && static_cast<std::size_t>(elem_index) < store_.size(), "Element being deallocated does not belong to this Memory pool.");
-            ASSERT(!store_[elem_index].is_free, "Expected in-use ObjectBlock at index:" + std::to_string(elem_index));
-            store_[elem_index].is_free = true;
+            ASSERT(!is_free_[elem_index], "Expected in-use object at index:" + std::to_string(elem_index));
+            is_free_[elem_index] = true;
+            free_indices_[free_top_++] = static_cast<uint32_t>(elem_index);
+        }
+
+        /// Position of an object from this pool, stable for its lifetime - lets callers keep side arrays parallel to the pool.
+        auto indexOf(const T* elem) const noexcept {
+            return static_cast<std::size_t>(elem - &(store_[0]));
+        }
+
+        /// Object at a position returned by indexOf().
+        T* at(std::size_t index) noexcept {
+            return &(store_[index]);
+        }
+
+        auto capacity() const noexcept {
+            return store_.size();
+        }
+
+        auto available() const noexcept {
+            return free_top_;
         }
 
         MemPool() = delete;
@@ -62,4 +77,4 @@ namespace Common {
         MemPool& operator=(const MemPool&) = delete;
         MemPool& operator=(const MemPool&&) = delete;
     };
-}
\ No newline at end of file
+}
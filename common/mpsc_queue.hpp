@@ -0,0 +1,127 @@
+/// Referenced https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "macros.hpp"
+
+namespace Common {
+    /// Bounded lock-free multi-producer single-consumer queue, with the same push / emplace / pop surface as LFQueue.
+    /// Producers claim a slot with a CAS on the write index, every slot carries a sequence number which tells the consumer
+    /// when the element in it has been published and the producers when the slot has been freed again.
+    template<typename T, typename Alloc = std::allocator<T>>
+    class MPSCQueue final {
+    private:
+        using size_type = typename std::allocator_traits<Alloc>::size_type;
+
+        struct Slot {
+            std::atomic<size_type> sequence_;
+            alignas(T) unsigned char storage_[sizeof(T)];
+
+            T* element() noexcept {
+                return reinterpret_cast<T*>(storage_);
+            }
+        };
+
+        using SlotAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Slot>;
+        using slot_allocator_traits = std::allocator_traits<SlotAlloc>;
+
+        SlotAlloc slot_alloc_;
+        size_type mask_ = 0;
+        Slot* slots_ = nullptr;
+
+        // Shared by all producers.
+        alignas(CACHE_LINE_SIZE) std::atomic<size_type> next_write_index_ = {0};
+
+        // Owned by the consumer, atomic only so that size() can be called from any thread.
+        alignas(CACHE_LINE_SIZE) std::atomic<size_type> next_read_index_ = {0};
+
+        static_assert(std::atomic<size_type>::is_always_lock_free);
+
+    public:
+        explicit MPSCQueue(size_type capacity, const Alloc& alloc = Alloc()) : slot_alloc_(alloc), mask_(capacity - 1),
+                slots_(slot_allocator_traits::allocate(slot_alloc_, capacity)) {
+            ASSERT(capacity && !(capacity & mask_), "MPSCQueue capacity must be a power of two:" + std::to_string(capacity));
+            for (size_type i = 0; i < capacity; ++i) {
+                new(&slots_[i].sequence_) std::atomic<size_type>(i);
+            }
+        }
+
+        ~MPSCQueue() {
+            for (auto index = next_read_index_.load(); slots_[index & mask_].sequence_ == index + 1; ++index) {
+                slots_[index & mask_].element()->~T();
+            }
+            slot_allocator_traits::deallocate(slot_alloc_, slots_, capacity());
+        }
+
+        bool push(const T& value) {
+            return emplace(value);
+        }
+
+        /// Safe to call from any number of threads concurrently, returns false if the queue is full.
+        template<typename... Args>
+        bool emplace(Args&&... args) {
+            auto next_write_index = next_write_index_.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &slots_[next_write_index & mask_];
+                const auto sequence = slot->sequence_.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::make_signed_t<size_type>>(sequence - next_write_index);
+                if (diff == 0) {
+                    if (next_write_index_.compare_exchange_weak(next_write_index, next_write_index + 1, std::memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false;   // slot still holds the element from the previous lap.
+                } else {
+                    next_write_index = next_write_index_.load(std::memory_order_relaxed);
+                }
+            }
+
+            new(slot->element()) T(std::forward<Args>(args)...);
+            slot->sequence_.store(next_write_index + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Single consumer only.
+        bool pop(T& value) {
+            const auto next_read_index = next_read_index_.load(std::memory_order_relaxed);
+            auto& slot = slots_[next_read_index & mask_];
+            if (slot.sequence_.load(std::memory_order_acquire) != next_read_index + 1) return false;
+
+            value = std::move(*slot.element());
+            slot.element()->~T();
+            slot.sequence_.store(next_read_index + capacity(), std::memory_order_release);
+            next_read_index_.store(next_read_index + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /// Approximate while producers are active - includes slots that have been claimed but not yet published.
+        auto size() const noexcept {
+            const auto next_read_index = next_read_index_.load(std::memory_order_relaxed);
+            const auto next_write_index = next_write_index_.load(std::memory_order_relaxed);
+            return next_write_index > next_read_index ? next_write_index - next_read_index : 0;
+        }
+
+        auto capacity() const noexcept {
+            return 1 + mask_;
+        }
+
+        bool full() const noexcept {
+            return size() == capacity();
+        }
+
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        MPSCQueue() = delete;
+        MPSCQueue(const MPSCQueue&) = delete;
+        MPSCQueue(const MPSCQueue&&) = delete;
+        MPSCQueue& operator=(const MPSCQueue&) = delete;
+        MPSCQueue& operator=(const MPSCQueue&&) = delete;
+    };
+}
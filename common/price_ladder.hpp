@@ -0,0 +1,253 @@
+#pragma once
+
+#include <vector>
+
+#include "level_bitmap.hpp"
+#include "macros.hpp"
+#include "types.hpp"
+
+namespace Common {
+    /// Compile-time ordering of one side of a book - which of two prices is better, and which way its levels are walked
+    /// from the best one.
+    template<Side S>
+    struct SidePolicy;
+
+    template<>
+    struct SidePolicy<Side::BUY> {
+        static constexpr Side OPPOSITE = Side::SELL;
+
+        static constexpr auto isBetter(Price price, Price other) noexcept {
+            return price > other;
+        }
+
+        static auto findBest(const LevelBitmap& levels) noexcept {
+            return levels.findLast();
+        }
+
+        static auto findNextWorse(const LevelBitmap& levels, size_t index) noexcept {
+            return levels.findPrev(index);
+        }
+    };
+
+    template<>
+    struct SidePolicy<Side::SELL> {
+        static constexpr Side OPPOSITE = Side::BUY;
+
+        static constexpr auto isBetter(Price price, Price other) noexcept {
+            return price < other;
+        }
+
+        static auto findBest(const LevelBitmap& levels) noexcept {
+            return levels.findFirst();
+        }
+
+        static auto findNextWorse(const LevelBitmap& levels, size_t index) noexcept {
+            return levels.findNext(index);
+        }
+    };
+
+    /// The levels of one side of a PriceLadder - their occupancy bitmap and a pointer to the best of them, kept up to date
+    /// as levels open and close. The side is a template parameter, so none of this branches on it at run time.
+    template<Side S, typename OrdersAtPrice>
+    class BookSide final {
+    private:
+        using Policy = SidePolicy<S>;
+
+        OrdersAtPrice* levels_ = nullptr;
+        LevelBitmap occupied_;
+        OrdersAtPrice* best_ = nullptr;
+
+    public:
+        BookSide(OrdersAtPrice* levels, size_t num_levels) : levels_(levels), occupied_(num_levels) {}
+
+        /// Best level or nullptr if the side is empty.
+        auto best() const noexcept -> OrdersAtPrice* {
+            return best_;
+        }
+
+        /// True if an order of the opposite side with a limit of price trades against the best level.
+        auto crossedBy(Price price) const noexcept {
+            return best_ != nullptr && !Policy::isBetter(price, best_->price_);
+        }
+
+        void open(size_t index) noexcept {
+            occupied_.set(index);
+            if (best_ == nullptr || Policy::isBetter(levels_[index].price_, best_->price_)) {
+                best_ = &levels_[index];
+            }
+        }
+
+        void close(size_t index) noexcept {
+            occupied_.clear(index);
+            if (best_ == &levels_[index]) {
+                const auto next_index = Policy::findNextWorse(occupied_, index);
+                best_ = (next_index == LevelBitmap::NPOS ? nullptr : &levels_[next_index]);
+            }
+        }
+
+        /// Calls f(level) for every level, best first.
+        template<typename F>
+        void forEachLevel(F&& f) const noexcept {
+            for (auto index = Policy::findBest(occupied_); index != LevelBitmap::NPOS; index = Policy::findNextWorse(occupied_, index)) {
+                f(levels_[index]);
+            }
+        }
+
+        /// Closes every level, without touching the orders in them.
+        void clear() noexcept {
+            for (auto index = Policy::findBest(occupied_); index != LevelBitmap::NPOS; index = Policy::findBest(occupied_)) {
+                levels_[index].first_order_ = nullptr;
+                occupied_.clear(index);
+            }
+            best_ = nullptr;
+        }
+
+        BookSide() = delete;
+        BookSide(const BookSide&) = delete;
+        BookSide(const BookSide&&) = delete;
+        BookSide& operator=(const BookSide&) = delete;
+        BookSide& operator=(const BookSide&&) = delete;
+    };
+
+    /// Order book core shared by the exchange and the trading books - a dense price ladder indexed by tick offset from the
+    /// instrument's base price, a level belongs to whichever side has orders resting at it, and every level is a circular
+    /// list of orders in priority order. Works with any OrdersAtPrice{first_order_, price_, side_} over orders linked by
+    /// prev_order_ / next_order_.
+    template<typename OrdersAtPrice>
+    class PriceLadder final {
+    private:
+        InstrumentConfig instrument_config_;
+
+        std::vector<OrdersAtPrice> levels_;
+        BookSide<Side::BUY, OrdersAtPrice> bids_;
+        BookSide<Side::SELL, OrdersAtPrice> asks_;
+
+    public:
+        explicit PriceLadder(const InstrumentConfig& instrument_config) : instrument_config_(instrument_config),
+                levels_(instrument_config.num_price_levels_), bids_(levels_.data(), levels_.size()), asks_(levels_.data(), levels_.size()) {
+            ASSERT(instrument_config.tick_size_ > 0, "Invalid tick size:" + priceToString(instrument_config.tick_size_));
+        }
+
+        auto isValidPrice(Price price) const noexcept {
+            return price >= instrument_config_.base_price_ && (price - instrument_config_.base_price_) % instrument_config_.tick_size_ == 0 &&
+                   (price - instrument_config_.base_price_) / instrument_config_.tick_size_ < instrument_config_.num_price_levels_;
+        }
+
+        auto priceToIndex(Price price) const noexcept {
+            return static_cast<size_t>((price - instrument_config_.base_price_) / instrument_config_.tick_size_);
+        }
+
+        /// Level at price or nullptr if nothing rests there.
+        auto getOrdersAtPrice(Price price) noexcept -> OrdersAtPrice* {
+            auto& orders_at_price = levels_[priceToIndex(price)];
+            return orders_at_price.first_order_ ? &orders_at_price : nullptr;
+        }
+
+        template<Side S>
+        auto& side() noexcept {
+            if constexpr (S == Side::BUY) {
+                return bids_;
+            }
+            else {
+                return asks_;
+            }
+        }
+
+        template<Side S>
+        const auto& side() const noexcept {
+            if constexpr (S == Side::BUY) {
+                return bids_;
+            }
+            else {
+                return asks_;
+            }
+        }
+
+        auto& bids() const noexcept {
+            return bids_;
+        }
+
+        auto& asks() const noexcept {
+            return asks_;
+        }
+
+        /// Queues order, of side S, at the back of its price level, opening the level if it is empty.
+        template<Side S, typename Order>
+        void addOrder(Order* order) noexcept {
+            const auto index = priceToIndex(order->price_);
+            auto& orders_at_price = levels_[index];
+
+            if (orders_at_price.first_order_ == nullptr) {
+                order->next_order_ = order->prev_order_ = order;
+                orders_at_price = {S, order->price_, order};
+                side<S>().open(index);
+            }
+            else {
+                auto first_order = orders_at_price.first_order_;
+                first_order->prev_order_->next_order_ = order;
+                order->prev_order_ = first_order->prev_order_;
+                first_order->prev_order_ = order;
+                order->next_order_ = first_order;
+            }
+        }
+
+        /// Unlinks order, of side S, from its price level, closing the level if it was the last order in it.
+        template<Side S, typename Order>
+        void removeOrder(Order* order) noexcept {
+            const auto index = priceToIndex(order->price_);
+            auto& orders_at_price = levels_[index];
+
+            if (order->next_order_ == order) {   // Only order at the price level
+                orders_at_price.first_order_ = nullptr;
+                side<S>().close(index);
+            }
+            else {
+                order->prev_order_->next_order_ = order->next_order_;
+                order->next_order_->prev_order_ = order->prev_order_;
+
+                if (orders_at_price.first_order_ == order) {
+                    orders_at_price.first_order_ = order->next_order_;
+                }
+            }
+
+            order->next_order_ = order->prev_order_ = nullptr;
+        }
+
+        template<typename Order>
+        void addOrder(Order* order) noexcept {
+            order->side_ == Side::BUY ? addOrder<Side::BUY>(order) : addOrder<Side::SELL>(order);
+        }
+
+        template<typename Order>
+        void removeOrder(Order* order) noexcept {
+            order->side_ == Side::BUY ? removeOrder<Side::BUY>(order) : removeOrder<Side::SELL>(order);
+        }
+
+        /// Calls f(order) for every order - bid levels best first, then ask levels best first, every level in priority order.
+        template<typename F>
+        void forEachOrder(F&& f) const noexcept {
+            const auto for_each_in_level = [&f](const OrdersAtPrice& orders_at_price) {
+                auto order = orders_at_price.first_order_;
+                do {
+                    f(order);
+                    order = order->next_order_;
+                } while (order != orders_at_price.first_order_);
+            };
+
+            bids_.forEachLevel(for_each_in_level);
+            asks_.forEachLevel(for_each_in_level);
+        }
+
+        /// Empties both sides, the orders themselves are left to the caller.
+        void clear() noexcept {
+            bids_.clear();
+            asks_.clear();
+        }
+
+        PriceLadder() = delete;
+        PriceLadder(const PriceLadder&) = delete;
+        PriceLadder(const PriceLadder&&) = delete;
+        PriceLadder& operator=(const PriceLadder&) = delete;
+        PriceLadder& operator=(const PriceLadder&&) = delete;
+    };
+}
@@ -19,10 +19,14 @@
 #include "macros.hpp"
 #include "logger.hpp"
 #include "time_utils.hpp"
+#include "huge_page_allocator.hpp"
 
 namespace Common {
     constexpr int MaxTCPServerBacklog = 1024;
 
+    /// Send / receive buffers of TCPSocket and MCastSocket, HugePageConfig passed to the socket picks the backing pages.
+    typedef std::vector<char, HugePageAllocator<char>> SocketBuffer;
+
     inline auto getIfaceIP(const std::string &iface) -> std::string {
         char buf[NI_MAXHOST] = {'\0'};
         ifaddrs* ifaddr = nullptr;
@@ -69,11 +73,10 @@ namespace Common {
     // Create a TCP / UDP socket to either connect to or listen for data on or listen for connections on the specified interface and IP:port information.
     inline auto createSocket(Logger &logger, const std::string& t_ip, const std::string& iface, int port, 
     bool is_udp, bool is_blocking, bool is_listening, bool needs_so_timestamp) -> int {
-        std::string time_str;
         const auto ip = t_ip.empty() ? getIfaceIP(iface) : t_ip;
 
         logger.log("%:% %() % ip:% iface:% port:% is_udp:% is_blocking:% is_listening:% SO_time:%\n", 
-        __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), ip, iface, port, is_udp, is_blocking, is_listening, needs_so_timestamp);
+        __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), ip, iface, port, is_udp, is_blocking, is_listening, needs_so_timestamp);
         
         const int input_flags = (is_listening ? AI_PASSIVE : 0) | (AI_NUMERICHOST | AI_NUMERICSERV);
         const addrinfo hints{input_flags, AF_INET, is_udp ? SOCK_DGRAM : SOCK_STREAM,
@@ -3,7 +3,7 @@
 namespace Common {
   // Add and remove socket file descriptors to and from the EPOLL list.
     auto TCPServer::addToEpollList(TCPSocket *socket) {
-        epoll_event ev{EPOLLET | EPOLLIN, {reinterpret_cast<void *>(socket)}};
+        epoll_event ev{EPOLLET | EPOLLIN | EPOLLRDHUP, {reinterpret_cast<void *>(socket)}};
         return !epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket->socket_fd_, &ev);
     }
 
@@ -33,6 +33,25 @@ namespace Common {
         std::for_each(send_sockets_.begin(), send_sockets_.end(), [](auto socket) {
             socket->sendAndRecv();
         });
+
+        for (auto socket : disconnected_sockets_) {
+            removeSocket(socket);
+        }
+        disconnected_sockets_.clear();
+    }
+
+    // Stop tracking a socket the peer hung up, let the listener drop its references to it, and close it.
+    void TCPServer::removeSocket(TCPSocket *socket) noexcept {
+        logger_.log("%:% %() % removing socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), socket->socket_fd_);
+
+        receive_sockets_.erase(std::remove(receive_sockets_.begin(), receive_sockets_.end(), socket), receive_sockets_.end());
+        send_sockets_.erase(std::remove(send_sockets_.begin(), send_sockets_.end(), socket), send_sockets_.end());
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket->socket_fd_, nullptr);
+
+        if (disconnect_callback_) {
+            disconnect_callback_(socket);
+        }
+        delete socket;
     }
 
     // Check for new connections or dead connections and update containers that track the sockets.
@@ -49,35 +68,37 @@ namespace Common {
             if (event.events & EPOLLIN) {
                 if (socket == &listener_socket_) {
                 logger_.log("%:% %() % EPOLLIN listener_socket:%\n", __FILE__, __LINE__, __FUNCTION__,
-                            Common::getCurrentTimeStr(&time_str_), socket->socket_fd_);
+                            Common::getCurrentTimestamp(), socket->socket_fd_);
                 have_new_connection = true;
                 continue;
                 }
                 logger_.log("%:% %() % EPOLLIN socket:%\n", __FILE__, __LINE__, __FUNCTION__,
-                            Common::getCurrentTimeStr(&time_str_), socket->socket_fd_);
+                            Common::getCurrentTimestamp(), socket->socket_fd_);
                 if (std::find(receive_sockets_.begin(), receive_sockets_.end(), socket) == receive_sockets_.end())
                 receive_sockets_.push_back(socket);
             }
 
             if (event.events & EPOLLOUT) {
                 logger_.log("%:% %() % EPOLLOUT socket:%\n", __FILE__, __LINE__, __FUNCTION__,
-                            Common::getCurrentTimeStr(&time_str_), socket->socket_fd_);
+                            Common::getCurrentTimestamp(), socket->socket_fd_);
                 if (std::find(send_sockets_.begin(), send_sockets_.end(), socket) == send_sockets_.end())
                 send_sockets_.push_back(socket);
             }
 
-            if (event.events & (EPOLLERR | EPOLLHUP)) {
-                logger_.log("%:% %() % EPOLLERR socket:%\n", __FILE__, __LINE__, __FUNCTION__,
-                            Common::getCurrentTimeStr(&time_str_), socket->socket_fd_);
+            if (event.events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+                logger_.log("%:% %() % EPOLLERR/EPOLLHUP socket:%\n", __FILE__, __LINE__, __FUNCTION__,
+                            Common::getCurrentTimestamp(), socket->socket_fd_);
                 if (std::find(receive_sockets_.begin(), receive_sockets_.end(), socket) == receive_sockets_.end())
                 receive_sockets_.push_back(socket);
+                if (std::find(disconnected_sockets_.begin(), disconnected_sockets_.end(), socket) == disconnected_sockets_.end())
+                disconnected_sockets_.push_back(socket);
             }
         }
 
         // Accept a new connection, create a TCPSocket and add it to our containers.
         while (have_new_connection) {
             logger_.log("%:% %() % have_new_connection\n", __FILE__, __LINE__, __FUNCTION__,
-                        Common::getCurrentTimeStr(&time_str_));
+                        Common::getCurrentTimestamp());
             sockaddr_storage addr;
             socklen_t addr_len = sizeof(addr);
             int fd = accept(listener_socket_.socket_fd_, reinterpret_cast<sockaddr *>(&addr), &addr_len);
@@ -88,7 +109,7 @@ namespace Common {
                     "Failed to set non-blocking or no-delay on socket:" + std::to_string(fd));
 
             logger_.log("%:% %() % accepted socket:%\n", __FILE__, __LINE__, __FUNCTION__,
-                        Common::getCurrentTimeStr(&time_str_), fd);
+                        Common::getCurrentTimestamp(), fd);
 
             auto socket = new TCPSocket(logger_);
             socket->socket_fd_ = fd;
@@ -15,6 +15,8 @@ namespace Common {
     private:
         auto addToEpollList(TCPSocket *socket);
 
+        void removeSocket(TCPSocket *socket) noexcept;
+
     public:
         int epoll_fd_ = -1;
         TCPSocket listener_socket_;
@@ -24,10 +26,13 @@ namespace Common {
         std::vector<TCPSocket *> receive_sockets_;
         std::vector<TCPSocket *> send_sockets_;
 
+        // Hung up by the peer, removed and deleted at the end of the next sendAndRecv() once their last data is dispatched.
+        std::vector<TCPSocket *> disconnected_sockets_;
+
         std::function<void(TCPSocket *s, Nanos rx_time)> recv_callback_ = nullptr;
         std::function<void()> recv_finished_callback_ = nullptr;
+        std::function<void(TCPSocket *s)> disconnect_callback_ = nullptr;
 
-        std::string time_str_;
         Logger &logger_;
     };
 }
@@ -9,9 +9,9 @@ namespace Common {
     constexpr size_t TCPBufferSize = 64 * 1024 * 1024;
 
     struct TCPSocket {
-        explicit TCPSocket(Logger &logger) : logger_(logger) {
-            outbound_data_.resize(TCPBufferSize);
-            inbound_data_.resize(TCPBufferSize);
+        explicit TCPSocket(Logger &logger, const HugePageConfig &buffer_config = HugePageConfig()) :
+                outbound_data_(TCPBufferSize, HugePageAllocator<char>(buffer_config)), inbound_data_(TCPBufferSize, HugePageAllocator<char>(buffer_config)),
+                logger_(logger) {
         }
 
         ~TCPSocket() {
@@ -31,16 +31,15 @@ namespace Common {
 
         int socket_fd_ = -1;
 
-        std::vector<char> outbound_data_;
+        SocketBuffer outbound_data_;
         size_t next_send_valid_index_ = 0;
-        std::vector<char> inbound_data_;
+        SocketBuffer inbound_data_;
         size_t next_rcv_valid_index_ = 0;
 
         struct sockaddr_in socket_attrib_{};
 
         std::function<void(TCPSocket *s, Nanos rx_time)> recv_callback_ = nullptr;
 
-        std::string time_str_;
         Logger &logger_;
     };
 }
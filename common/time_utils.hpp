@@ -3,9 +3,16 @@
 #include <string>
 #include <chrono>
 #include <ctime>
+#include <atomic>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace Common {
   typedef int64_t Nanos;
+  typedef uint64_t Ticks;
 
   constexpr Nanos NANOS_TO_MICROS = 1000;
   constexpr Nanos MICROS_TO_MILLIS = 1000;
@@ -13,8 +20,162 @@ namespace Common {
   constexpr Nanos NANOS_TO_MILLIS = NANOS_TO_MICROS * MICROS_TO_MILLIS;
   constexpr Nanos NANOS_TO_SECS = NANOS_TO_MILLIS * MILLIS_TO_SECS;
 
+  constexpr Nanos TSC_CALIBRATION_INTERVAL = 1 * NANOS_TO_SECS;
+  constexpr Nanos TSC_MIN_CALIBRATION_WINDOW = 10 * NANOS_TO_MILLIS;
+
+  // Raw cycle counter - a few nanoseconds, no syscall or vDSO call. Falls back to steady_clock on non-x86.
+  inline auto rdtsc() noexcept -> Ticks {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+  }
+
+  inline auto clockNanos(clockid_t clock_id) noexcept -> Nanos {
+    timespec ts;
+    clock_gettime(clock_id, &ts);
+    return ts.tv_sec * NANOS_TO_SECS + ts.tv_nsec;
+  }
+
+  /// Linear mapping of TSC ticks onto CLOCK_REALTIME nanoseconds, valid around base_ticks_.
+  struct TSCCalibration {
+    Ticks base_ticks_ = 0;
+    Nanos base_nanos_ = 0;
+    double nanos_per_tick_ = 1.0;
+
+    auto toNanos(Ticks ticks) const noexcept -> Nanos {
+      return base_nanos_ + static_cast<Nanos>(static_cast<double>(static_cast<int64_t>(ticks - base_ticks_)) * nanos_per_tick_);
+    }
+  };
+
+  /// Process wide TSC clock. Hot paths only read rdtsc(), ticks are converted to wall time off the hot path using the
+  /// latest calibration, which is published through a seqlock and refreshed by calibrate() against CLOCK_MONOTONIC (rate)
+  /// and CLOCK_REALTIME (offset).
+  class TSCClock final {
+  private:
+    std::atomic<uint64_t> sequence_ = {0};
+    std::atomic<Ticks> base_ticks_ = {0};
+    std::atomic<Nanos> base_nanos_ = {0};
+    std::atomic<double> nanos_per_tick_ = {1.0};
+
+    // Owned by whichever thread holds calibrating_.
+    std::atomic_flag calibrating_ = ATOMIC_FLAG_INIT;
+    Ticks anchor_ticks_ = 0;
+    Nanos anchor_mono_nanos_ = 0;
+    Nanos last_calibration_mono_nanos_ = 0;
+
+    TSCClock() {
+      sample(&anchor_ticks_, &anchor_mono_nanos_, nullptr);
+
+      const auto start = clockNanos(CLOCK_MONOTONIC);
+      while (clockNanos(CLOCK_MONOTONIC) - start < TSC_MIN_CALIBRATION_WINDOW);
+
+      calibrate(true);
+    }
+
+    // Reads the TSC on both sides of the clock reads and uses the midpoint, to keep the pair as tight as possible.
+    static void sample(Ticks *ticks, Nanos *mono_nanos, Nanos *real_nanos) noexcept {
+      const auto before = rdtsc();
+      *mono_nanos = clockNanos(CLOCK_MONOTONIC);
+      if (real_nanos) {
+        *real_nanos = clockNanos(CLOCK_REALTIME);
+      }
+      const auto after = rdtsc();
+      *ticks = before + (after - before) / 2;
+    }
+
+  public:
+    static auto& instance() noexcept {
+      static TSCClock clock;
+      return clock;
+    }
+
+    auto calibration() const noexcept {
+      TSCCalibration calibration;
+      uint64_t sequence;
+      do {
+        sequence = sequence_.load(std::memory_order_acquire);
+        calibration.base_ticks_ = base_ticks_.load(std::memory_order_relaxed);
+        calibration.base_nanos_ = base_nanos_.load(std::memory_order_relaxed);
+        calibration.nanos_per_tick_ = nanos_per_tick_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+      } while ((sequence & 1) || sequence != sequence_.load(std::memory_order_relaxed));
+
+      return calibration;
+    }
+
+    // Incremented on every published calibration, lets consumers notice a new one.
+    auto version() const noexcept {
+      return sequence_.load(std::memory_order_acquire) / 2;
+    }
+
+    auto toNanos(Ticks ticks) const noexcept {
+      return calibration().toNanos(ticks);
+    }
+
+    /// Re-measures the tick rate and re-anchors to CLOCK_REALTIME. Cheap no-op unless TSC_CALIBRATION_INTERVAL has elapsed
+    /// or another thread is already calibrating, so it can be called from every polling loop that is off the hot path.
+    void calibrate(bool force = false) noexcept {
+      if (calibrating_.test_and_set(std::memory_order_acquire)) {
+        return;
+      }
+
+      Ticks ticks;
+      Nanos mono_nanos, real_nanos;
+      sample(&ticks, &mono_nanos, &real_nanos);
+
+      if (force || mono_nanos - last_calibration_mono_nanos_ >= TSC_CALIBRATION_INTERVAL) {
+        const double nanos_per_tick = (ticks > anchor_ticks_) ?
+                                      static_cast<double>(mono_nanos - anchor_mono_nanos_) / static_cast<double>(ticks - anchor_ticks_) : 1.0;
+
+        const auto sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        base_ticks_.store(ticks, std::memory_order_relaxed);
+        base_nanos_.store(real_nanos, std::memory_order_relaxed);
+        nanos_per_tick_.store(nanos_per_tick, std::memory_order_relaxed);
+        sequence_.store(sequence + 2, std::memory_order_release);
+
+        anchor_ticks_ = ticks;
+        anchor_mono_nanos_ = mono_nanos;
+        last_calibration_mono_nanos_ = mono_nanos;
+      }
+
+      calibrating_.clear(std::memory_order_release);
+    }
+
+    TSCClock(const TSCClock&) = delete;
+    TSCClock(const TSCClock&&) = delete;
+    TSCClock& operator=(const TSCClock&) = delete;
+    TSCClock& operator=(const TSCClock&&) = delete;
+  };
+
+  /// Raw TSC reading for Logger::log() arguments, formatted as wall-clock time by the logger thread.
+  struct Timestamp {
+    Ticks ticks_ = 0;
+  };
+
+  inline auto getCurrentTimestamp() noexcept {
+    return Timestamp{rdtsc()};
+  }
+
   inline auto getCurrentNanos() noexcept {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return TSCClock::instance().toNanos(rdtsc());
+  }
+
+  // Formats like ctime() with nanoseconds, e.g. "Sun Oct 18 09:30:00.000000123 2026".
+  inline auto& nanosToTimeStr(Nanos nanos, std::string* time_str) {
+    const time_t secs = nanos / NANOS_TO_SECS;
+    tm local_tm;
+    localtime_r(&secs, &local_tm);
+
+    char date[32], year[8], buf[64];
+    strftime(date, sizeof(date), "%a %b %e %H:%M:%S", &local_tm);
+    strftime(year, sizeof(year), "%Y", &local_tm);
+    snprintf(buf, sizeof(buf), "%s.%09ld %s", date, static_cast<long>(nanos % NANOS_TO_SECS), year);
+    time_str->assign(buf);
+    return *time_str;
   }
 
   inline auto& getCurrentTimeStr(std::string* time_str) {
@@ -24,4 +185,4 @@ namespace Common {
       time_str->at(time_str->length()-1) = '\0';
     return *time_str;
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "macros.hpp"
+#include "time_utils.hpp"
+
+namespace Common {
+    struct TimingWheelNode {
+        uint64_t expiry_tick_ = 0;      // 0 while not scheduled.
+        uint32_t prev_ = 0;
+        uint32_t next_ = 0;
+    };
+
+    /// Hierarchical timing wheel over the timer ids [0, capacity), e.g. the indices of a MemPool. Time is counted in ticks
+    /// of tick nanoseconds, a timer sits in the level of the most significant 6 bit group in which its expiry tick differs
+    /// from the current tick, in the slot that group selects - so it is only touched again when the current tick reaches
+    /// the start of that slot, where it is cascaded one or more levels down or fired. Expiries past the top level wait in
+    /// an overflow list. schedule() and cancel() are O(1), advance() skips empty stretches of time with one countr_zero
+    /// per level.
+    template<typename Alloc = std::allocator<TimingWheelNode>>
+    class TimingWheel final {
+    public:
+        using TimerId = uint32_t;
+
+    private:
+        static constexpr size_t SLOT_BITS = 6;
+        static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+        static constexpr size_t LEVELS = 6;
+        static constexpr size_t OVERFLOW_SLOT = LEVELS * SLOTS;
+        static constexpr TimerId TimerId_NONE = std::numeric_limits<TimerId>::max();
+
+        const Nanos tick_;
+        uint64_t current_tick_ = 0;
+        size_t size_ = 0;
+
+        std::vector<TimingWheelNode, Alloc> nodes_;
+        std::array<TimerId, OVERFLOW_SLOT + 1> slots_;
+        std::array<uint64_t, LEVELS> occupied_ = {};
+
+        static constexpr auto levelOf(uint64_t expiry_tick, uint64_t current_tick) noexcept -> size_t {
+            return (static_cast<size_t>(std::bit_width((expiry_tick ^ current_tick) | 1)) - 1) / SLOT_BITS;
+        }
+
+        auto slotOf(uint64_t expiry_tick) const noexcept -> size_t {
+            const auto level = levelOf(expiry_tick, current_tick_);
+            return level < LEVELS ? level * SLOTS + ((expiry_tick >> (level * SLOT_BITS)) & (SLOTS - 1)) : OVERFLOW_SLOT;
+        }
+
+        void link(TimerId id) noexcept {
+            auto &node = nodes_[id];
+            const auto slot = slotOf(node.expiry_tick_);
+            node.prev_ = TimerId_NONE;
+            node.next_ = slots_[slot];
+            if (node.next_ != TimerId_NONE) {
+                nodes_[node.next_].prev_ = id;
+            }
+            slots_[slot] = id;
+            if (slot != OVERFLOW_SLOT) {
+                occupied_[slot / SLOTS] |= uint64_t{1} << (slot % SLOTS);
+            }
+        }
+
+        void unlink(TimerId id) noexcept {
+            const auto &node = nodes_[id];
+            if (node.prev_ != TimerId_NONE) {
+                nodes_[node.prev_].next_ = node.next_;
+            }
+            else {
+                const auto slot = slotOf(node.expiry_tick_);
+                slots_[slot] = node.next_;
+                if (node.next_ == TimerId_NONE && slot != OVERFLOW_SLOT) {
+                    occupied_[slot / SLOTS] &= ~(uint64_t{1} << (slot % SLOTS));
+                }
+            }
+            if (node.next_ != TimerId_NONE) {
+                nodes_[node.next_].prev_ = node.prev_;
+            }
+        }
+
+        // Re-files every timer of a slot whose start the current tick has reached, into lower levels.
+        void cascade(size_t slot) noexcept {
+            auto id = slots_[slot];
+            slots_[slot] = TimerId_NONE;
+            if (slot != OVERFLOW_SLOT) {
+                occupied_[slot / SLOTS] &= ~(uint64_t{1} << (slot % SLOTS));
+            }
+            while (id != TimerId_NONE) {
+                const auto next = nodes_[id].next_;
+                link(id);
+                id = next;
+            }
+        }
+
+        // The next tick at which a slot is reached, i.e. something fires or cascades. Only valid while size_ > 0.
+        auto nextTick() const noexcept -> uint64_t {
+            auto next_tick = std::numeric_limits<uint64_t>::max();
+            for (size_t level = 0; level < LEVELS; ++level) {
+                const auto shift = level * SLOT_BITS;
+                const auto index = (current_tick_ >> shift) & (SLOTS - 1);
+                const auto later = occupied_[level] & (index == SLOTS - 1 ? 0 : ~uint64_t{0} << (index + 1));
+                if (later) {
+                    const auto block = (current_tick_ >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+                    next_tick = std::min(next_tick, block | (static_cast<uint64_t>(std::countr_zero(later)) << shift));
+                }
+            }
+            if (slots_[OVERFLOW_SLOT] != TimerId_NONE) {
+                next_tick = std::min(next_tick, ((current_tick_ >> (LEVELS * SLOT_BITS)) + 1) << (LEVELS * SLOT_BITS));
+            }
+            return next_tick;
+        }
+
+    public:
+        TimingWheel(size_t capacity, Nanos tick, const Alloc& alloc = Alloc()) : tick_(tick), nodes_(capacity, TimingWheelNode(), alloc) {
+            ASSERT(capacity < TimerId_NONE, "TimingWheel capacity too large:" + std::to_string(capacity));
+            ASSERT(tick_ > 0, "TimingWheel tick must be positive.");
+            slots_.fill(TimerId_NONE);
+        }
+
+        /// Fires id on the first advance() to or past deadline, rounded up to a tick and at least one tick from now.
+        void schedule(TimerId id, Nanos deadline) noexcept {
+            cancel(id);
+            nodes_[id].expiry_tick_ = std::max(current_tick_ + 1, static_cast<uint64_t>((deadline + tick_ - 1) / tick_));
+            link(id);
+            ++size_;
+        }
+
+        void cancel(TimerId id) noexcept {
+            if (nodes_[id].expiry_tick_ != 0) {
+                unlink(id);
+                nodes_[id].expiry_tick_ = 0;
+                --size_;
+            }
+        }
+
+        auto isScheduled(TimerId id) const noexcept {
+            return nodes_[id].expiry_tick_ != 0;
+        }
+
+        /// Deadline of a scheduled timer, rounded up to its tick.
+        auto deadline(TimerId id) const noexcept -> Nanos {
+            return static_cast<Nanos>(nodes_[id].expiry_tick_) * tick_;
+        }
+
+        /// Earliest time advance() has work to do, a cascade or an expiry. Max Nanos if nothing is scheduled.
+        auto nextDeadline() const noexcept -> Nanos {
+            return size_ ? static_cast<Nanos>(nextTick()) * tick_ : std::numeric_limits<Nanos>::max();
+        }
+
+        auto size() const noexcept {
+            return size_;
+        }
+
+        /// Moves time forward to now, calling on_expired(id) for every timer that expires on the way, earliest tick first.
+        /// on_expired may schedule or cancel any timer, time never moves backwards.
+        template<typename OnExpired>
+        void advance(Nanos now, OnExpired&& on_expired) noexcept {
+            const auto target_tick = static_cast<uint64_t>(now / tick_);
+            while (current_tick_ < target_tick) {
+                const auto next_tick = size_ ? nextTick() : std::numeric_limits<uint64_t>::max();
+                if (next_tick > target_tick) {
+                    current_tick_ = target_tick;
+                    break;
+                }
+                current_tick_ = next_tick;
+
+                // Highest level first, a timer can cascade through several levels in the same tick.
+                if ((current_tick_ & ((uint64_t{1} << (LEVELS * SLOT_BITS)) - 1)) == 0) {
+                    cascade(OVERFLOW_SLOT);
+                }
+                for (size_t level = LEVELS - 1; level > 0; --level) {
+                    const auto shift = level * SLOT_BITS;
+                    if ((current_tick_ & ((uint64_t{1} << shift) - 1)) == 0) {
+                        cascade(level * SLOTS + ((current_tick_ >> shift) & (SLOTS - 1)));
+                    }
+                }
+
+                // Popped one at a time, so on_expired can freely cancel the others.
+                auto &due = slots_[current_tick_ & (SLOTS - 1)];
+                while (due != TimerId_NONE) {
+                    const auto id = due;
+                    cancel(id);
+                    on_expired(id);
+                }
+            }
+        }
+
+        TimingWheel() = delete;
+        TimingWheel(const TimingWheel&) = delete;
+        TimingWheel(const TimingWheel&&) = delete;
+        TimingWheel& operator=(const TimingWheel&) = delete;
+        TimingWheel& operator=(const TimingWheel&&) = delete;
+    };
+}
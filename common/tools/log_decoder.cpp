@@ -0,0 +1,58 @@
+#include <fstream>
+#include <unordered_map>
+
+#include "common/logger.hpp"
+
+// Formats a log file written by a Logger in LogMode::BINARY to stdout.
+int main(int argc, char **argv) {
+    using namespace Common;
+
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <binary log file>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file(argv[1], std::ios::in | std::ios::binary);
+    ASSERT(file.is_open(), "Failed to open log file: " + std::string(argv[1]));
+
+    char magic[sizeof(LOG_BINARY_MAGIC)];
+    file.read(magic, sizeof(magic));
+    ASSERT(file && !memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)), std::string(argv[1]) + " is not a binary log file");
+
+    std::unordered_map<uint32_t, std::string> formats;
+    std::vector<char> args;
+    TSCCalibration calibration;
+
+    LogBinaryEntry entry;
+    while (file.read(reinterpret_cast<char *>(&entry), sizeof(entry))) {
+        uint32_t id = 0, length = 0;
+        file.read(reinterpret_cast<char *>(&id), sizeof(id));
+        file.read(reinterpret_cast<char *>(&length), sizeof(length));
+        args.resize(length);
+        file.read(args.data(), length);
+        if (!file) {
+            std::cerr << "Truncated entry at end of " << argv[1] << std::endl;
+            break;
+        }
+
+        switch (entry) {
+            case LogBinaryEntry::FORMAT:
+                formats[id].assign(args.data(), length);
+            break;
+            case LogBinaryEntry::RECORD: {
+                const auto format = formats.find(id);
+                ASSERT(format != formats.end(), "Record refers to unknown format id:" + std::to_string(id));
+                formatLogRecord(std::cout, format->second.c_str(), args.data(), length, calibration);
+            }
+            break;
+            case LogBinaryEntry::CALIBRATION:
+                ASSERT(length == sizeof(calibration), "Unexpected calibration entry size:" + std::to_string(length));
+                memcpy(&calibration, args.data(), sizeof(calibration));
+            break;
+            default:
+                FATAL("Unknown entry type:" + std::to_string(static_cast<int>(entry)));
+        }
+    }
+
+    return 0;
+}
@@ -7,14 +7,14 @@
 #include "macros.hpp"
 
 namespace Common {
-    constexpr size_t ME_MAX_TICKERS = 8;
+    constexpr size_t ME_MAX_TICKERS = 1024;
     
     constexpr size_t ME_MAX_CLIENT_UPDATES = 256 * 1024;
     constexpr size_t ME_MAX_MARKET_UPDATES = 256 * 1024;
 
     constexpr size_t ME_MAX_NUM_CLIENTS = 256;
     constexpr size_t ME_MAX_ORDER_IDS = 1024 * 1024;
-    constexpr size_t ME_MAX_PRICE_LEVELS = 256;
+    constexpr size_t ME_MAX_PRICE_LEVELS = 256 * 1024;
     
     typedef uint32_t TickerId;
     constexpr TickerId TickerId_INVALID = std::numeric_limits<TickerId>::max();
@@ -100,4 +100,13 @@ namespace Common {
         
         return std::to_string(priority);
     }
+
+    /// Price ladder of an instrument - level i is the price base_price_ + i * tick_size_ - and how many of its orders can
+    /// rest in the book at once.
+    struct InstrumentConfig {
+        Price base_price_ = 0;
+        Price tick_size_ = 1;
+        size_t num_price_levels_ = ME_MAX_PRICE_LEVELS;
+        size_t max_orders_ = ME_MAX_ORDER_IDS;
+    };
 }
\ No newline at end of file
@@ -3,60 +3,164 @@
 #include "matching_engine/matching_engine.hpp"
 #include "order_server/order_server.hpp"
 #include "market_data/market_data_publisher.hpp"
+#include "order_server/journal_replayer.hpp"
 
 Common::Logger* logger = nullptr;
-Exchange::MatchingEngine* matching_engine = nullptr;
+std::vector<Exchange::MatchingEngine*> matching_engines;
+Exchange::MEShardChannelsList me_shards;
 Exchange::OrderServer* order_server = nullptr;
 Exchange::MarketDataPublisher* market_data_publisher = nullptr;
+Exchange::MEClientRequestJournalWriter* journal = nullptr;
 
 void signal_handler(int) {
     using namespace std::literals::chrono_literals;
     std::this_thread::sleep_for(10s);
 
     delete logger; logger = nullptr;
-    delete matching_engine; matching_engine = nullptr;
-    delete order_server; matching_engine = nullptr;
-    delete market_data_publisher; matching_engine = nullptr;
+    for (auto &matching_engine : matching_engines) {
+        delete matching_engine; matching_engine = nullptr;
+    }
+    delete order_server; order_server = nullptr;
+    delete market_data_publisher; market_data_publisher = nullptr;
+    delete journal; journal = nullptr;
+    for (auto &me_shard : me_shards) {
+        delete me_shard; me_shard = nullptr;
+    }
 
     std::this_thread::sleep_for(10s);
 
     exit(EXIT_SUCCESS);
 }
 
-int main() {
+/// Replays requests through the matching engines and waits for them to be processed, draining and discarding the client
+/// responses, which the clients have already seen. Returns the sequence number following the last replayed request.
+size_t replayJournal(std::span<const Exchange::MESequencedClientRequest> requests, size_t journal_seq_num) {
+    Exchange::JournalReplayer replayer(me_shards, logger);
+
+    volatile bool draining = true;
+    auto drain_thread = Common::createAndStartThread(-1, "Exchange/ReplayDrain", [&]() {
+        while (draining) {
+            Exchange::mergeShardOutputs(me_shards,
+                [](size_t shard) { return me_shards[shard]->client_responses_.peekRead(me_shards[shard]->client_responses_.capacity()); },
+                [](size_t shard, size_t count) { me_shards[shard]->client_responses_.releaseRead(count); },
+                [](const Exchange::MESequencedClientResponse&) {});
+        }
+    });
+
+    const auto end_seq_num = replayer.replay(requests, journal_seq_num);
+    while (!replayer.done(end_seq_num));
+
+    draining = false;
+    drain_thread->join();
+    delete drain_thread;
+
+    return end_seq_num;
+}
+
+/// Replays the journal through the matching engines as fast as they consume it and exits.
+void replayOnly(const std::string &journal_file) {
+    Exchange::MEClientRequestJournalReader journal_reader(journal_file);
+
+    const auto start = Common::getCurrentNanos();
+    replayJournal(journal_reader.records(), journal_reader.firstIndex() + 1);
+    const auto elapsed = Common::getCurrentNanos() - start;
+
+    const auto seconds = static_cast<double>(elapsed) / Common::NANOS_TO_SECS;
+    printf("Replayed %zu requests from %s through %zu shards in %.3f s, %.0f requests/s\n", journal_reader.records().size(),
+           journal_file.c_str(), me_shards.size(), seconds, static_cast<double>(journal_reader.records().size()) / seconds);
+    logger->log("%:% %() % Replayed % requests in % ns.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                journal_reader.records().size(), elapsed);
+
+    // Dumps the final books to the matching engine logs.
+    for (auto &matching_engine : matching_engines) {
+        delete matching_engine; matching_engine = nullptr;
+    }
+    delete logger; logger = nullptr;
+}
+
+/// Usage: exchange_main [num_me_shards] [first_me_core] [journal_file] [replay|cancel_on_disconnect] [per_fill|per_level]
+///                      [instruments_file] [fairness_window_us]
+/// Tickers are partitioned across num_me_shards matching engine threads, shard i is pinned to core first_me_core + i
+/// unless first_me_core is negative. Every sequenced request is appended to journal_file (exchange_journal.bin by default)
+/// before it reaches the matching engines. Shard i checkpoints its books to journal_file.checkpoint.i periodically and on
+/// shutdown, and on startup restores them from there and replays only the journal tail. Once the journal is half full it
+/// is started over from the oldest checkpoint, the older records are kept in journal_file.<index of the first one>. With
+/// "replay" the whole journal is replayed into empty books as fast as possible, the throughput printed, and the process
+/// exits - only possible while it has not been started over. With
+/// "cancel_on_disconnect" every resting order of a client is cancelled when its order gateway connection drops. With
+/// "per_level" an aggressive order gets one execution and the feed one trade per price level swept, instead of per fill.
+/// Only the instruments in instruments_file (see exchange/instruments.cfg) get books, sized by their own price level and
+/// order capacities, requests for other tickers are rejected. Without it tickers 0 to 7 are traded with default capacities.
+/// Client requests are held for fairness_window_us (0 by default) before being sequenced, so requests read from different
+/// connections in different polls are still sequenced in the order the kernel received them.
+int main(int argc, char **argv) {
+    const size_t num_me_shards = argc > 1 ? std::stoul(argv[1]) : 1;
+    const int first_me_core = argc > 2 ? atoi(argv[2]) : -1;
+    const std::string journal_file = argc > 3 ? argv[3] : "exchange_journal.bin";
+    const std::string mode = argc > 4 ? argv[4] : "";
+    const bool replay_only = (mode == "replay");
+    const bool cancel_on_disconnect = (mode == "cancel_on_disconnect");
+    const std::string execution_reports = argc > 5 ? argv[5] : "per_fill";
+    ASSERT(execution_reports == "per_fill" || execution_reports == "per_level", "Invalid execution report mode:" + execution_reports);
+    const auto execution_report_mode = (execution_reports == "per_level" ? Exchange::ExecutionReportMode::PER_LEVEL :
+                                                                            Exchange::ExecutionReportMode::PER_FILL);
+    const auto instrument_configs = (argc > 6 ? Common::loadInstrumentConfigs(argv[6]) : Common::defaultInstrumentConfigs());
+    const Common::Nanos fairness_window = (argc > 7 ? std::stol(argv[7]) : 0) * Common::NANOS_TO_MICROS;
+    ASSERT(num_me_shards > 0 && num_me_shards <= Exchange::ME_MAX_SHARDS, "Invalid number of matching engine shards:" + std::to_string(num_me_shards));
+
     logger = new Common::Logger("exchange_main.log");
 
     std::signal(SIGINT, signal_handler);
 
     const int sleep_time = 100 * 1000;
 
-    Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
-    Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
-    Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
-
-    std::string time_str;
+    for (size_t i = 0; i < num_me_shards; ++i) {
+        me_shards.push_back(new Exchange::MEShardChannels());
+    }
 
-    logger->log("%:% %() % Starting Matching Engine...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-    matching_engine = new Exchange::MatchingEngine(&client_requests, &client_responses, &market_updates);
-    matching_engine->start();
+    if (replay_only) {
+        for (size_t i = 0; i < num_me_shards; ++i) {
+            matching_engines.push_back(new Exchange::MatchingEngine(i, num_me_shards, me_shards[i], instrument_configs, "", execution_report_mode));
+            matching_engines.back()->start(first_me_core < 0 ? -1 : first_me_core + static_cast<int>(i));
+        }
+        replayOnly(journal_file);
+        exit(EXIT_SUCCESS);
+    }
 
     const std::string mkt_pub_iface = "lo";
     const std::string snap_pub_ip = "233.252.14.1", inc_pub_ip = "233.252.14.3";
     const int snap_pub_port = 20000, inc_pub_port = 20001;
 
-    logger->log("%:% %() % Starting Market Data Publisher...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-    market_data_publisher = new Exchange::MarketDataPublisher(&market_updates, mkt_pub_iface, snap_pub_ip, snap_pub_port, inc_pub_ip, inc_pub_port);
+    // Started before the matching engines so it sees the orders they publish when restoring a checkpoint.
+    logger->log("%:% %() % Starting Market Data Publisher...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
+    market_data_publisher = new Exchange::MarketDataPublisher(me_shards, mkt_pub_iface, snap_pub_ip, snap_pub_port, inc_pub_ip, inc_pub_port);
     market_data_publisher->start();
 
+    for (size_t i = 0; i < num_me_shards; ++i) {
+        logger->log("%:% %() % Starting Matching Engine shard %...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), i);
+        matching_engines.push_back(new Exchange::MatchingEngine(i, num_me_shards, me_shards[i], instrument_configs,
+                                                                 journal_file + ".checkpoint." + std::to_string(i), execution_report_mode));
+        matching_engines.back()->start(first_me_core < 0 ? -1 : first_me_core + static_cast<int>(i));
+    }
+
+    logger->log("%:% %() % Recovering from journal %...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), journal_file);
+    journal = new Exchange::MEClientRequestJournalWriter(journal_file, Exchange::ME_JOURNAL_MAX_RECORDS, Exchange::ME_JOURNAL_SYNC_INTERVAL);
+    const auto first_live_seq_num = replayJournal(journal->records(), journal->firstIndex() + 1);
+
     const std::string order_gw_iface = "lo";
     const int order_gw_port = 12345;
 
-    logger->log("%:% %() % Starting Order Server...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-    order_server = new Exchange::OrderServer(order_gw_iface, order_gw_port, &client_responses, &client_requests);
+    logger->log("%:% %() % Starting Order Server...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
+    order_server = new Exchange::OrderServer(order_gw_iface, order_gw_port, me_shards, instrument_configs, journal, first_live_seq_num,
+                                             cancel_on_disconnect, fairness_window);
     order_server->start();
 
     while (true) {
-        logger->log("%:% %() % Sleeping for a few milliseconds..\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
+        logger->log("%:% %() % Sleeping for a few milliseconds..\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
         usleep(sleep_time * 1000);
+
+        for (auto matching_engine : matching_engines) {
+            matching_engine->requestCheckpoint();
+        }
     }
 }
\ No newline at end of file
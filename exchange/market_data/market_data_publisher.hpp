@@ -4,33 +4,34 @@
 #include "common/mcast_socket.hpp"
 #include "market_data/market_update.hpp"
 #include "market_data/snapshot_synthesizer.hpp"
+#include "matching_engine/me_shard.hpp"
 
 namespace Exchange {
 class MarketDataPublisher {
 private:
-    MEMarketUpdateLFQueue* outgoing_md_updates_ = nullptr;
+    MEShardChannelsList shards_;
+    std::array<MEMarketUpdateBroadcastQueue::ReaderId, ME_MAX_SHARDS> reader_ids_;
+
     size_t next_inc_seq_num_ = 1;
-    PubMarketUpdateLFQueue snapshot_md_updates_;
 
     volatile bool running_ = false;
 
     Logger logger_;
-    std::string time_str_;
 
     Common::MCastSocket incremental_updates_socket_;
 
     SnapshotSynthesizer* snapshot_synthesizer_;
 
-    MEMarketUpdate market_update_;
-    PubMarketUpdate pub_market_update_;
 
 public:
-    MarketDataPublisher(MEMarketUpdateLFQueue* outgoing_md_updates, const std::string &iface,
+    MarketDataPublisher(const MEShardChannelsList& shards, const std::string &iface,
         const std::string &snapshot_ip, int snapshot_port, const std::string &incremental_ip, int incremental_port) 
-        : outgoing_md_updates_(outgoing_md_updates), snapshot_md_updates_(ME_MAX_MARKET_UPDATES), 
-        logger_("exchange_market_data_publisher.log"), incremental_updates_socket_(logger_) {
+        : shards_(shards), logger_("exchange_market_data_publisher.log"), incremental_updates_socket_(logger_) {
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                reader_ids_[i] = shards_[i]->market_updates_.addReader();
+            }
             ASSERT(incremental_updates_socket_.init(incremental_ip, iface, incremental_port, false) >= 0, "Unable to create incremental mcast socket. error:" + std::string(std::strerror(errno)));
-            snapshot_synthesizer_ = new SnapshotSynthesizer(&snapshot_md_updates_, iface, snapshot_ip, snapshot_port);
+            snapshot_synthesizer_ = new SnapshotSynthesizer(shards, iface, snapshot_ip, snapshot_port);
         }
 
     ~MarketDataPublisher() {
@@ -55,19 +56,20 @@ public:
     }
 
     void run() {
-        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
         while (running_) {
-            while (outgoing_md_updates_->pop(market_update_)) {
-                logger_.log("%:% %() % Sending seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), next_inc_seq_num_,
-                            market_update_.toString().c_str());
-
-                incremental_updates_socket_.send(&next_inc_seq_num_, sizeof(next_inc_seq_num_));
-                incremental_updates_socket_.send(&market_update_, sizeof(MEMarketUpdate));
-
-                pub_market_update_ = {next_inc_seq_num_, std::move(market_update_)};
-                snapshot_md_updates_.push(std::move(pub_market_update_));
-                ++next_inc_seq_num_;
-            }
+            // Updates of all shards merged back into request sequence order, incremental sequence numbers count the merged stream.
+            mergeShardOutputs(shards_,
+                [this](size_t shard) { return shards_[shard]->market_updates_.peekRead(reader_ids_[shard], shards_[shard]->market_updates_.capacity()); },
+                [this](size_t shard, size_t count) { shards_[shard]->market_updates_.releaseRead(reader_ids_[shard], count); },
+                [this](const MESequencedMarketUpdate& market_update) {
+                    logger_.log("%:% %() % Sending seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), next_inc_seq_num_,
+                                market_update.me_market_update_.toString().c_str());
+
+                    incremental_updates_socket_.send(&next_inc_seq_num_, sizeof(next_inc_seq_num_));
+                    incremental_updates_socket_.send(&market_update.me_market_update_, sizeof(MEMarketUpdate));
+                    ++next_inc_seq_num_;
+                });
 
             incremental_updates_socket_.sendAndRecv();
         }
@@ -4,6 +4,8 @@
 
 #include "common/types.hpp"
 #include "common/lf_queue.hpp"
+#include "common/broadcast_queue.hpp"
+#include "common/huge_page_allocator.hpp"
 
 using namespace Common;
 
@@ -83,6 +85,12 @@ namespace Exchange {
 
     #pragma pack(pop)
 
-    typedef LFQueue<MEMarketUpdate> MEMarketUpdateLFQueue;
-    typedef LFQueue<PubMarketUpdate> PubMarketUpdateLFQueue;
+    /// MEMarketUpdate tagged with the sequence number of the request that produced it.
+    struct MESequencedMarketUpdate {
+        size_t seq_num_ = 0;
+        MEMarketUpdate me_market_update_;
+    };
+
+    typedef LFQueue<MEMarketUpdate, HugePageAllocator<MEMarketUpdate>> MEMarketUpdateLFQueue;
+    typedef BroadcastQueue<MESequencedMarketUpdate, HugePageAllocator<MESequencedMarketUpdate>> MEMarketUpdateBroadcastQueue;
 }
\ No newline at end of file
@@ -1,12 +1,12 @@
 #include "market_data/snapshot_synthesizer.hpp"
 
 namespace Exchange {
-    SnapshotSynthesizer::SnapshotSynthesizer(PubMarketUpdateLFQueue* snapshot_md_updates, const std::string &iface, 
-        const std::string &snapshot_ip, int snapshot_port) : snapshot_md_updates_(snapshot_md_updates), logger_("exchange_snapshot_synthesizer.log"),
+    SnapshotSynthesizer::SnapshotSynthesizer(const MEShardChannelsList& shards, const std::string &iface, 
+        const std::string &snapshot_ip, int snapshot_port) : shards_(shards), logger_("exchange_snapshot_synthesizer.log"),
         snapshot_updates_socket_(logger_), order_pool_(ME_MAX_ORDER_IDS) {
             ASSERT(snapshot_updates_socket_.init(snapshot_ip, iface, snapshot_port, /*is_listening*/ false) >= 0, "Unable to create snapshot mcast socket. error:" + std::string(std::strerror(errno)));
-        for(auto& orders : ticker_orders_) {
-            orders.fill(nullptr);
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            reader_ids_[i] = shards_[i]->market_updates_.addReader();
         }
     }
 
@@ -25,14 +25,19 @@ namespace Exchange {
     }
 
     void SnapshotSynthesizer::run() {
-        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str_));
+        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
         while (running_) {
-            while (snapshot_md_updates_->pop(market_update_)) {
-                logger_.log("%:% %() % Processing %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str_),
-                    market_update_.toString().c_str());
-
-                addToSnapshot(&market_update_);
-            }
+            // Same merge as the MarketDataPublisher, so both see the updates in the same order under the same sequence numbers.
+            mergeShardOutputs(shards_,
+                [this](size_t shard) { return shards_[shard]->market_updates_.peekRead(reader_ids_[shard], shards_[shard]->market_updates_.capacity()); },
+                [this](size_t shard, size_t count) { shards_[shard]->market_updates_.releaseRead(reader_ids_[shard], count); },
+                [this](const MESequencedMarketUpdate& market_update) {
+                    const auto seq_num = last_inc_seq_num_ + 1;
+                    logger_.log("%:% %() % Processing seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                        seq_num, market_update.me_market_update_.toString().c_str());
+
+                    addToSnapshot(seq_num, &market_update.me_market_update_);
+                });
         }
 
         if (getCurrentNanos() - last_snapshot_time_ > 60 * NANOS_TO_SECS) {
@@ -41,11 +46,14 @@ namespace Exchange {
         }
     }
 
-    void SnapshotSynthesizer::addToSnapshot(const PubMarketUpdate* market_update) {
-        const auto& me_market_update = market_update->me_market_update_;
+    void SnapshotSynthesizer::addToSnapshot(size_t seq_num, const MEMarketUpdate* market_update) {
+        const auto& me_market_update = *market_update;
         auto *orders = &ticker_orders_.at(me_market_update.ticker_id_);
         switch (me_market_update.type_) {
         case MarketUpdateType::ADD: {
+            if (me_market_update.order_id_ >= orders->size()) {
+                orders->resize(std::bit_ceil(me_market_update.order_id_ + 1), nullptr);
+            }
             auto order = orders->at(me_market_update.order_id_);
             ASSERT(order == nullptr, "Received:" + me_market_update.toString() + " but order already exists:" + (order ? order->toString() : ""));
             orders->at(me_market_update.order_id_) = order_pool_.allocate(me_market_update);
@@ -59,6 +67,7 @@ namespace Exchange {
 
             order->qty_ = me_market_update.qty_;
             order->price_ = me_market_update.price_;
+            order->priority_ = me_market_update.priority_;
         }
         break;
         case MarketUpdateType::CANCEL: {
@@ -79,32 +88,35 @@ namespace Exchange {
         break;
         }
 
-        ASSERT(market_update->seq_num_ == last_inc_seq_num_ + 1, "Expected incremental seq_nums to increase.");
-        last_inc_seq_num_ = market_update->seq_num_;
+        ASSERT(seq_num == last_inc_seq_num_ + 1, "Expected incremental seq_nums to increase.");
+        last_inc_seq_num_ = seq_num;
     }
 
     void SnapshotSynthesizer::publishSnapshot() {
         size_t snapshot_size = 0;
 
         const PubMarketUpdate start_market_update{snapshot_size++, {MarketUpdateType::SNAPSHOT_START, last_inc_seq_num_}};
-        logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str_), start_market_update.toString());
+        logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), start_market_update.toString());
         snapshot_updates_socket_.send(&start_market_update, sizeof(PubMarketUpdate));
 
         for (size_t ticker_id = 0; ticker_id < ticker_orders_.size(); ++ticker_id) {
             const auto &orders = ticker_orders_.at(ticker_id);
+            if (orders.empty()) {   // never had an order.
+                continue;
+            }
 
             MEMarketUpdate me_market_update;
             me_market_update.type_ = MarketUpdateType::CLEAR;
             me_market_update.ticker_id_ = ticker_id;
 
             const PubMarketUpdate clear_market_update{snapshot_size++, me_market_update};
-            logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str_), clear_market_update.toString());
+            logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), clear_market_update.toString());
             snapshot_updates_socket_.send(&clear_market_update, sizeof(PubMarketUpdate));
 
             for (const auto order: orders) {
                 if (order) {
                     const PubMarketUpdate market_update{snapshot_size++, *order};
-                    logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str_), market_update.toString());
+                    logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), market_update.toString());
                     snapshot_updates_socket_.send(&market_update, sizeof(PubMarketUpdate));
                     snapshot_updates_socket_.sendAndRecv();
                 }
@@ -112,10 +124,10 @@ namespace Exchange {
         }
 
         const PubMarketUpdate end_market_update{snapshot_size++, {MarketUpdateType::SNAPSHOT_END, last_inc_seq_num_}};
-        logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str_), end_market_update.toString());
+        logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), end_market_update.toString());
         snapshot_updates_socket_.send(&end_market_update, sizeof(PubMarketUpdate));
         snapshot_updates_socket_.sendAndRecv();
 
-        logger_.log("%:% %() % Published snapshot of % orders.\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str_), snapshot_size - 1);
+        logger_.log("%:% %() % Published snapshot of % orders.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), snapshot_size - 1);
     }
 }
\ No newline at end of file
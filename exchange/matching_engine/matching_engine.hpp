@@ -1,67 +1,118 @@
 #pragma once
 
+#include <atomic>
+#include <cstdio>
+#include <unistd.h>
+#include <vector>
+
 #include "order_server/client_request.hpp"
+#include "matching_engine/me_checkpoint.hpp"
+#include "matching_engine/me_event_tap.hpp"
 #include "matching_engine/me_orderbook.hpp"
+#include "matching_engine/me_shard.hpp"
 
+#include "common/instruments.hpp"
 #include "common/macros.hpp"
 
 namespace Exchange{
+    /// Matches the books of the configured tickers assigned to one shard, requests for any other ticker are rejected. Every output is tagged with the sequence number of the
+    /// request being processed, and done_seq_num_ is advanced once all outputs of a request have been published.
+    /// With a checkpoint file the books are restored from it by start(), rewritten between requests whenever
+    /// requestCheckpoint() is called, and written a last time on destruction. Every request and output is recorded raw to
+    /// the shard's MEEventTap, the log only gets the rare book and checkpoint events.
     class MatchingEngine final {
     private:
         OrderBookHashMap ticker_order_book_;
 
-        ClientRequestLFQueue* incoming_requests_ = nullptr;
-        ClientResponseLFQueue* outgoing_responses_ = nullptr;
-        MEMarketUpdateLFQueue* outgoing_md_updates_ = nullptr;
+        // The books allocated in ticker_order_book_, for the loops over every book.
+        std::vector<MEOrderBook*> order_books_;
+
+        const size_t shard_id_ = 0;
+        MEShardChannels* channels_ = nullptr;
+
+        size_t current_seq_num_ = 0;
+        size_t done_seq_num_ = 0;
+
+        // Only moved by the receive times of sequenced requests, so expiries replay exactly from the journal. The FIFOSequencer
+        // sends a TIMER request once next_expiry_time_ is due to move it while no other requests arrive.
+        Nanos time_ = 0;
+
+        // Never later than the earliest time a book has expiries to run - lowered as orders are scheduled, recomputed once
+        // reached. The books are only advanced then, not on every request.
+        Nanos next_expiry_time_ = std::numeric_limits<Nanos>::max();
+        Nanos published_expiry_time_ = std::numeric_limits<Nanos>::max();
+
+        const std::string checkpoint_file_;
+        std::atomic<bool> checkpoint_requested_ = {false};
 
         volatile bool running_ = false;
+        std::thread* thread_ = nullptr;
         
-        std::string time_str_;
         Logger logger_;
-
-        MEClientRequest me_client_request;
+        MEEventTap event_tap_;
 
     public:
-        MatchingEngine(ClientRequestLFQueue *client_requests, ClientResponseLFQueue *client_responses, MEMarketUpdateLFQueue *market_updates) :
-        incoming_requests_(client_requests), outgoing_responses_(client_responses), outgoing_md_updates_(market_updates), logger_("exchange_matching_engine.log") {
+        /// Books are only allocated for the configured tickers, each sized by its instrument.
+        MatchingEngine(size_t shard_id, size_t num_shards, MEShardChannels* channels, const InstrumentConfigs& instrument_configs,
+                       const std::string& checkpoint_file, ExecutionReportMode execution_report_mode) :
+        shard_id_(shard_id), channels_(channels), checkpoint_file_(checkpoint_file),
+        logger_("exchange_matching_engine_" + std::to_string(shard_id) + ".log"),
+        event_tap_("exchange_matching_engine_" + std::to_string(shard_id) + ".events") {
+            ticker_order_book_.fill(nullptr);
             for(auto i = 0uL; i < ticker_order_book_.size(); ++i) {
-                ticker_order_book_[i] = new MEOrderBook(i, this, &logger_);
+                if (instrument_configs[i] && shardOf(i, num_shards) == shard_id_) {
+                    ticker_order_book_[i] = new MEOrderBook(i, *instrument_configs[i], execution_report_mode, this, &logger_);
+                    order_books_.push_back(ticker_order_book_[i]);
+                }
             }
         }
 
         ~MatchingEngine() {
             running_ = false;
 
-            using namespace std::literals::chrono_literals;
-            std::this_thread::sleep_for(1s);    
+            // The final checkpoint is written by the matching thread once it stops between two requests.
+            if (thread_ != nullptr) {
+                thread_->join();
+                delete thread_;
+                thread_ = nullptr;
+            }
 
-            incoming_requests_ = nullptr;
-            outgoing_responses_ = nullptr;
-            outgoing_md_updates_ = nullptr;
+            channels_ = nullptr;
 
-            for (auto& orderbook : ticker_order_book_) {
-                delete orderbook;
-                orderbook = nullptr;
+            for (auto order_book : order_books_) {
+                delete order_book;
             }
+            order_books_.clear();
+            ticker_order_book_.fill(nullptr);
         }
 
-        void start() {
+        void start(int core_id) {
             running_ = true;
-            ASSERT(Common::createAndStartThread(-1, "Exchange/MatchingEngine", [this]() { run(); }) != nullptr, "Failed to start MatchingEngine thread.");
+            if (!checkpoint_file_.empty()) {
+                loadCheckpoint();
+            }
+            thread_ = Common::createAndStartThread(core_id, "Exchange/MatchingEngine/" + std::to_string(shard_id_), [this]() { run(); });
+            ASSERT(thread_ != nullptr, "Failed to start MatchingEngine thread.");
         }
 
         void stop() {
             running_ = false;
         }
 
+        /// Picked up by the matching thread before its next batch of requests.
+        void requestCheckpoint() noexcept {
+            checkpoint_requested_.store(true, std::memory_order_release);
+        }
+
+        // Outputs are only dropped on shutdown, otherwise a full queue stalls matching until the consumer catches up.
         void sendClientResponse(const MEClientResponse& client_response) {
-            logger_.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), client_response.toString());
-            outgoing_responses_->push(client_response);
+            event_tap_.record(current_seq_num_, client_response);
+            while (!channels_->client_responses_.push({current_seq_num_, client_response}) && running_);
         }
 
         void sendMarketUpdate(const MEMarketUpdate& market_update) {
-            logger_.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), market_update.toString());
-            outgoing_md_updates_->push(market_update);
+            event_tap_.record(current_seq_num_, market_update);
+            while (!channels_->market_updates_.push({current_seq_num_, market_update}) && running_);
         }
 
         MatchingEngine() = delete;
@@ -72,28 +123,204 @@ namespace Exchange{
 
     private:
         void processClientRequest(const MEClientRequest& client_request) noexcept {
-            MEOrderBook* order_book = ticker_order_book_[client_request.ticker_id_];
+            if (client_request.type_ == ClientRequestType::TIMER) {     // time has already been advanced to it.
+                return;
+            }
+
+            if (client_request.type_ == ClientRequestType::CANCEL_ALL_SHARD) {
+                for (auto order_book : order_books_) {
+                    order_book->cancelAll(client_request.client_id_, client_request.side_);
+                }
+                return;
+            }
+
+            MEOrderBook* order_book = client_request.ticker_id_ < ticker_order_book_.size() ? ticker_order_book_[client_request.ticker_id_] : nullptr;
+            if (order_book == nullptr) [[unlikely]] {
+                rejectClientRequest(client_request);
+                return;
+            }
+
             switch (client_request.type_) {
                 case ClientRequestType::NEW:
+                    order_book->expireOrders(time_);
                     order_book->add(client_request.client_id_, client_request.client_order_id_, client_request.side_, 
-                            client_request.price_, client_request.qty_);
+                            client_request.price_, client_request.qty_, client_request.expiry_time_);
+                    next_expiry_time_ = std::min(next_expiry_time_, order_book->nextExpiryTime());
                 break;
                 case ClientRequestType::CANCEL:
                     order_book->cancel(client_request.client_id_, client_request.client_order_id_);
                 break;
+                case ClientRequestType::MODIFY:
+                    order_book->expireOrders(time_);
+                    order_book->modify(client_request.client_id_, client_request.client_order_id_, client_request.price_, client_request.qty_);
+                    next_expiry_time_ = std::min(next_expiry_time_, order_book->nextExpiryTime());
+                break;
+                case ClientRequestType::CANCEL_ALL:
+                    order_book->cancelAll(client_request.client_id_, client_request.side_);
+                break;
+                default:
+                    FATAL("Received invalid client-request-type:" + clientRequestTypeToString(client_request.type_));
+            }
+        }
+
+        /// Answers a request for a ticker without a book. A CANCEL_ALL has nothing to cancel there and gets no response, as
+        /// on a book where the client has no orders.
+        void rejectClientRequest(const MEClientRequest& client_request) noexcept {
+            ClientResponseType type = ClientResponseType::INVALID;
+            switch (client_request.type_) {
+                case ClientRequestType::NEW:
+                    type = ClientResponseType::REJECTED;
+                break;
+                case ClientRequestType::CANCEL:
+                    type = ClientResponseType::CANCEL_REJECTED;
+                break;
+                case ClientRequestType::MODIFY:
+                    type = ClientResponseType::MODIFY_REJECTED;
+                break;
+                case ClientRequestType::CANCEL_ALL:
+                    return;
                 default:
                     FATAL("Received invalid client-request-type:" + clientRequestTypeToString(client_request.type_));
             }
+
+            sendClientResponse({type, client_request.client_id_, client_request.ticker_id_, client_request.client_order_id_, OrderId_INVALID,
+                                client_request.side_, client_request.price_, Qty_INVALID, client_request.qty_});
+        }
+
+        /// Written to a temporary file and renamed over the previous checkpoint, so a crash never leaves a partial one behind.
+        void writeCheckpoint() noexcept {
+            const auto tmp_file = checkpoint_file_ + ".tmp";
+            auto file = fopen(tmp_file.c_str(), "wb");
+            ASSERT(file != nullptr, "Unable to open checkpoint:" + tmp_file + " errno:" + std::string(strerror(errno)));
+
+            MECheckpointHeader header;
+            header.seq_num_ = done_seq_num_;
+            header.time_ = time_;
+            header.num_books_ = static_cast<uint32_t>(order_books_.size());
+            ASSERT(fwrite(&header, sizeof(header), 1, file) == 1, "Failed to write checkpoint:" + tmp_file);
+
+            for (const auto order_book : order_books_) {
+                order_book->writeCheckpoint(file);
+            }
+
+            ASSERT(fflush(file) == 0 && fsync(fileno(file)) == 0, "Failed to flush checkpoint:" + tmp_file + " errno:" + std::string(strerror(errno)));
+            fclose(file);
+            ASSERT(rename(tmp_file.c_str(), checkpoint_file_.c_str()) == 0, "Failed to rename checkpoint:" + tmp_file + " errno:" +
+                   std::string(strerror(errno)));
+            channels_->checkpointed_seq_num_.store(done_seq_num_, std::memory_order_release);
+
+            logger_.log("%:% %() % Wrote checkpoint % at seq:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                        checkpoint_file_, done_seq_num_);
+        }
+
+        /// Restores the books, publishes an ADD for every restored order and moves done_seq_num_ to where the checkpoint was
+        /// taken, which is where the JournalReplayer starts feeding this shard.
+        void loadCheckpoint() noexcept {
+            auto file = fopen(checkpoint_file_.c_str(), "rb");
+            if (file == nullptr) {
+                logger_.log("%:% %() % No checkpoint %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), checkpoint_file_);
+                return;
+            }
+
+            MECheckpointHeader header;
+            ASSERT(fread(&header, sizeof(header), 1, file) == 1 && header.magic_ == ME_CHECKPOINT_MAGIC && header.version_ == ME_CHECKPOINT_VERSION,
+                   "Not a checkpoint file:" + checkpoint_file_);
+
+            // The empty books are moved to the checkpoint time first, so the restored expiries are scheduled as they were.
+            time_ = header.time_;
+            for (auto order_book : order_books_) {
+                order_book->expireOrders(time_);
+            }
+            for (uint32_t i = 0; i < header.num_books_; ++i) {
+                MECheckpointBook book;
+                ASSERT(fread(&book, sizeof(book), 1, file) == 1, "Truncated checkpoint:" + checkpoint_file_);
+                ASSERT(book.ticker_id_ < ticker_order_book_.size() && ticker_order_book_[book.ticker_id_] != nullptr,
+                       "Checkpoint " + checkpoint_file_ + " has ticker:" + tickerIdToString(book.ticker_id_) + " which is not configured on shard:" +
+                       std::to_string(shard_id_));
+                ticker_order_book_[book.ticker_id_]->loadCheckpoint(file, book);
+                next_expiry_time_ = std::min(next_expiry_time_, ticker_order_book_[book.ticker_id_]->nextExpiryTime());
+            }
+            fclose(file);
+
+            // Sequenced just before the first request still to be replayed into this shard.
+            current_seq_num_ = header.seq_num_ ? header.seq_num_ - 1 : 0;
+            for (const auto order_book : order_books_) {
+                order_book->publishOrders();
+            }
+            publishDone(header.seq_num_);
+            publishNextExpiryTime();
+            channels_->checkpointed_seq_num_.store(header.seq_num_, std::memory_order_release);
+
+            logger_.log("%:% %() % Loaded checkpoint % at seq:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                        checkpoint_file_, header.seq_num_);
+        }
+
+        /// Moves time forward to time, if it is later, running the expiries of every book once next_expiry_time_ is reached.
+        /// Books not advanced in between are caught up before they schedule an expiry, in processClientRequest(), so the
+        /// outputs are the same as if every book was advanced on every request.
+        void advanceTime(Nanos time) noexcept {
+            if (time > time_) {
+                time_ = time;
+                if (time_ >= next_expiry_time_) [[unlikely]] {
+                    next_expiry_time_ = std::numeric_limits<Nanos>::max();
+                    for (auto order_book : order_books_) {
+                        order_book->expireOrders(time_);
+                        next_expiry_time_ = std::min(next_expiry_time_, order_book->nextExpiryTime());
+                    }
+                }
+            }
+        }
+
+        void publishNextExpiryTime() noexcept {
+            if (next_expiry_time_ != published_expiry_time_) {
+                published_expiry_time_ = next_expiry_time_;
+                channels_->next_expiry_time_.store(published_expiry_time_, std::memory_order_release);
+            }
+        }
+
+        void publishDone(size_t done_seq_num) noexcept {
+            if (done_seq_num > done_seq_num_) {
+                done_seq_num_ = done_seq_num;
+                channels_->done_seq_num_.store(done_seq_num_, std::memory_order_release);
+            }
         }
         
         void run() noexcept {
+            auto &incoming_requests = channels_->client_requests_;
             while (running_) {
-                if (incoming_requests_->pop(me_client_request)) [[likely]] {
-                    logger_.log("%:% %() % Processing %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
-                      me_client_request.toString());
-                    processClientRequest(me_client_request);
+                if (checkpoint_requested_.load(std::memory_order_acquire)) [[unlikely]] {
+                    checkpoint_requested_.store(false, std::memory_order_relaxed);
+                    writeCheckpoint();
+                }
+
+                // Read before the queue - once the queue is drained every request routed below it has been processed.
+                const auto routed_seq_num = channels_->routed_seq_num_.load(std::memory_order_acquire);
+
+                const auto client_requests = incoming_requests.peekRead(incoming_requests.capacity());
+                if (!client_requests.empty()) [[likely]] {
+                    size_t processed = 0;
+                    for (const auto &client_request : client_requests) {
+                        event_tap_.record(client_request.seq_num_, client_request.me_client_request_);
+                        current_seq_num_ = client_request.seq_num_;
+                        advanceTime(client_request.recv_time_);
+                        processClientRequest(client_request.me_client_request_);
+                        publishDone(current_seq_num_ + 1);
+                        ++processed;
+                        if (!running_) [[unlikely]] {
+                            break;
+                        }
+                    }
+                    incoming_requests.releaseRead(processed);
+                    publishNextExpiryTime();
+                }
+                else {
+                    publishDone(routed_seq_num);
                 }
             }
+
+            if (!checkpoint_file_.empty()) {
+                writeCheckpoint();
+            }
         }
     };
 }
\ No newline at end of file
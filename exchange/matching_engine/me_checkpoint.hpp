@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#include "common/time_utils.hpp"
+#include "common/types.hpp"
+
+using namespace Common;
+
+namespace Exchange {
+    constexpr uint64_t ME_CHECKPOINT_MAGIC = 0x54504b434b4f4f42ull;     // "BOOKCKPT"
+    constexpr uint32_t ME_CHECKPOINT_VERSION = 2;
+
+    /// Orders are read back in chunks of this many records.
+    constexpr size_t ME_CHECKPOINT_READ_BATCH = 4096;
+
+    #pragma pack(push, 1)
+    /// Start of a matching engine shard checkpoint, followed by num_books_ book sections.
+    struct MECheckpointHeader {
+        uint64_t magic_ = ME_CHECKPOINT_MAGIC;
+        uint32_t version_ = ME_CHECKPOINT_VERSION;
+        uint32_t num_books_ = 0;
+
+        // Every request below this sequence number routed to the shard is reflected in the books.
+        uint64_t seq_num_ = 0;
+
+        // Time the shard had advanced to, order expiries up to it have run.
+        Nanos time_ = 0;
+    };
+
+    /// Start of a book section, followed by num_orders_ orders - bid levels best first, then ask levels best first, every
+    /// level in priority order.
+    struct MECheckpointBook {
+        TickerId ticker_id_ = TickerId_INVALID;
+        OrderId next_order_id_ = OrderId_INVALID;
+        uint64_t num_orders_ = 0;
+    };
+
+    struct MECheckpointOrder {
+        OrderId client_order_id_ = OrderId_INVALID;
+        OrderId market_order_id_ = OrderId_INVALID;
+        ClientId client_id_ = ClientId_INVALID;
+        Side side_ = Side::INVALID;
+        Price price_ = Price_INVALID;
+        Qty qty_ = Qty_INVALID;
+        Priority priority_ = Priority_INVALID;
+        Nanos expiry_time_ = 0;
+    };
+    #pragma pack(pop)
+}
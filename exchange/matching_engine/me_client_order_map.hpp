@@ -0,0 +1,108 @@
+#pragma once
+
+#include <bit>
+#include <vector>
+
+#include "common/huge_page_allocator.hpp"
+#include "common/macros.hpp"
+#include "common/types.hpp"
+
+using namespace Common;
+
+namespace Exchange {
+    struct MEOrder;
+
+    /// Open addressing map from (client id, client order id) to the resting MEOrder, sized by the number of live orders
+    /// instead of the id space. Linear probing keeps lookups on consecutive cache lines, erase() shifts the following
+    /// entries of the probe run back so no tombstones accumulate.
+    class ClientOrderHashMap final {
+    private:
+        struct Entry {
+            OrderId client_order_id_ = OrderId_INVALID;
+            ClientId client_id_ = ClientId_INVALID;
+            MEOrder* order_ = nullptr;      // nullptr marks an empty slot.
+        };
+
+        std::vector<Entry, HugePageAllocator<Entry>> entries_;
+        size_t mask_ = 0;
+        size_t size_ = 0;
+
+        static auto hash(ClientId client_id, OrderId client_order_id) noexcept {
+            auto h = client_order_id * 0x9E3779B97F4A7C15ull ^ (static_cast<uint64_t>(client_id) * 0xC2B2AE3D27D4EB4Full);
+            return h ^ (h >> 29);
+        }
+
+        auto homeSlot(ClientId client_id, OrderId client_order_id) const noexcept {
+            return hash(client_id, client_order_id) & mask_;
+        }
+
+        /// Slot holding the key, or the empty slot that ends its probe run.
+        auto findSlot(ClientId client_id, OrderId client_order_id) const noexcept {
+            auto slot = homeSlot(client_id, client_order_id);
+            while (entries_[slot].order_ &&
+                   (entries_[slot].client_id_ != client_id || entries_[slot].client_order_id_ != client_order_id)) {
+                slot = (slot + 1) & mask_;
+            }
+            return slot;
+        }
+
+    public:
+        /// Capacity is the next power of two at or above twice max_orders, so the load factor stays at or below one half.
+        explicit ClientOrderHashMap(size_t max_orders, const HugePageConfig& huge_page_config = HugePageConfig()) :
+                entries_(std::bit_ceil(2 * max_orders), Entry(), HugePageAllocator<Entry>(huge_page_config)), mask_(entries_.size() - 1) {
+        }
+
+        auto find(ClientId client_id, OrderId client_order_id) const noexcept -> MEOrder* {
+            return entries_[findSlot(client_id, client_order_id)].order_;
+        }
+
+        /// Inserts or overwrites the order for the key.
+        auto insert(ClientId client_id, OrderId client_order_id, MEOrder* order) noexcept {
+            auto &entry = entries_[findSlot(client_id, client_order_id)];
+            if (!entry.order_) {
+                ASSERT(size_ < entries_.size() / 2, "ClientOrderHashMap full, size:" + std::to_string(size_));
+                ++size_;
+            }
+            entry = {client_order_id, client_id, order};
+        }
+
+        auto erase(ClientId client_id, OrderId client_order_id) noexcept {
+            auto hole = findSlot(client_id, client_order_id);
+            if (!entries_[hole].order_) {
+                return;
+            }
+
+            // Backward shift - move every later entry of the run whose home slot is not cyclically in (hole, slot] into the hole.
+            for (auto slot = (hole + 1) & mask_; entries_[slot].order_; slot = (slot + 1) & mask_) {
+                const auto home = homeSlot(entries_[slot].client_id_, entries_[slot].client_order_id_);
+                const bool stays = (hole < slot) ? (hole < home && home <= slot) : (hole < home || home <= slot);
+                if (!stays) {
+                    entries_[hole] = entries_[slot];
+                    hole = slot;
+                }
+            }
+
+            entries_[hole] = Entry();
+            --size_;
+        }
+
+        auto clear() noexcept {
+            std::fill(entries_.begin(), entries_.end(), Entry());
+            size_ = 0;
+        }
+
+        auto size() const noexcept {
+            return size_;
+        }
+
+        auto capacity() const noexcept {
+            return entries_.size();
+        }
+
+        ClientOrderHashMap() = delete;
+        ClientOrderHashMap(const ClientOrderHashMap&) = delete;
+        ClientOrderHashMap(const ClientOrderHashMap&&) = delete;
+        ClientOrderHashMap& operator=(const ClientOrderHashMap&) = delete;
+        ClientOrderHashMap& operator=(const ClientOrderHashMap&&) = delete;
+    };
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "common/huge_page_allocator.hpp"
+#include "common/lf_queue.hpp"
+#include "common/macros.hpp"
+#include "common/thread_utils.hpp"
+#include "common/time_utils.hpp"
+
+#include "order_server/client_request.hpp"
+#include "order_server/client_response.hpp"
+#include "market_data/market_update.hpp"
+
+using namespace Common;
+
+namespace Exchange {
+    constexpr uint64_t ME_EVENT_TAP_MAGIC = 0x5350415454564545ull;     // "EEVTTAPS"
+    constexpr uint32_t ME_EVENT_TAP_VERSION = 1;
+
+    /// Events queued between the matching thread and the drainer, about 15MB.
+    constexpr size_t ME_EVENT_TAP_QUEUE_SIZE = 256 * 1024;
+
+    enum class MEEventType : uint8_t {
+        INVALID = 0,
+        CLIENT_REQUEST = 1,
+        CLIENT_RESPONSE = 2,
+        MARKET_UPDATE = 3,
+        CALIBRATION = 4,    // written by the drainer, converts ticks_ of the events that follow to wall time.
+    };
+
+    inline std::string meEventTypeToString(MEEventType type) {
+        switch (type) {
+            case MEEventType::INVALID:
+                return "INVALID";
+            case MEEventType::CLIENT_REQUEST:
+                return "CLIENT_REQUEST";
+            case MEEventType::CLIENT_RESPONSE:
+                return "CLIENT_RESPONSE";
+            case MEEventType::MARKET_UPDATE:
+                return "MARKET_UPDATE";
+            case MEEventType::CALIBRATION:
+                return "CALIBRATION";
+        }
+
+        return "UNKNOWN";
+    }
+
+    #pragma pack(push, 1)
+    /// One message seen by a matching engine, stored raw with the TSC reading it was seen at and the sequence number of
+    /// the request it belongs to.
+    struct MEEvent {
+        Ticks ticks_ = 0;
+        uint64_t seq_num_ = 0;
+        MEEventType type_ = MEEventType::INVALID;
+        union {
+            MEClientRequest client_request_;
+            MEClientResponse client_response_;
+            MEMarketUpdate market_update_;
+            TSCCalibration calibration_;
+        };
+
+        MEEvent() : calibration_() {}
+        MEEvent(Ticks ticks, uint64_t seq_num, const MEClientRequest& client_request) :
+                ticks_(ticks), seq_num_(seq_num), type_(MEEventType::CLIENT_REQUEST), client_request_(client_request) {}
+        MEEvent(Ticks ticks, uint64_t seq_num, const MEClientResponse& client_response) :
+                ticks_(ticks), seq_num_(seq_num), type_(MEEventType::CLIENT_RESPONSE), client_response_(client_response) {}
+        MEEvent(Ticks ticks, uint64_t seq_num, const MEMarketUpdate& market_update) :
+                ticks_(ticks), seq_num_(seq_num), type_(MEEventType::MARKET_UPDATE), market_update_(market_update) {}
+        explicit MEEvent(const TSCCalibration& calibration) : type_(MEEventType::CALIBRATION), calibration_(calibration) {}
+
+        std::string toString(const TSCCalibration& calibration) const {
+            std::string time_str;
+            std::stringstream ss;
+            ss << nanosToTimeStr(calibration.toNanos(ticks_), &time_str) << " seq:" << seq_num_ << " ";
+            switch (type_) {
+                case MEEventType::CLIENT_REQUEST:
+                    ss << client_request_.toString();
+                break;
+                case MEEventType::CLIENT_RESPONSE:
+                    ss << client_response_.toString();
+                break;
+                case MEEventType::MARKET_UPDATE:
+                    ss << market_update_.toString();
+                break;
+                default:
+                    ss << meEventTypeToString(type_);
+                break;
+            }
+            return ss.str();
+        }
+    };
+    #pragma pack(pop)
+
+    /// Start of an event tap file, followed by MEEvent records of event_size_ bytes each.
+    struct METapHeader {
+        uint64_t magic_ = ME_EVENT_TAP_MAGIC;
+        uint32_t version_ = ME_EVENT_TAP_VERSION;
+        uint32_t event_size_ = sizeof(MEEvent);
+    };
+
+    /// Binary audit trail of a matching engine shard. The matching thread copies every message it receives or sends into a
+    /// SPSC ring together with a TSC reading, no formatting and no syscalls. A background thread appends the ring to file_name
+    /// as raw MEEvents, preceded by a CALIBRATION event whenever the TSC calibration changes, for tools/me_event_decoder.
+    class MEEventTap final {
+    private:
+        const std::string file_name_;
+        FILE* file_ = nullptr;
+        LFQueue<MEEvent, HugePageAllocator<MEEvent>> events_;
+        std::thread* drain_thread_ = nullptr;
+        std::atomic<bool> running_ = {true};
+        uint64_t calibration_version_ = 0;
+
+    public:
+        explicit MEEventTap(const std::string& file_name) : file_name_(file_name), events_(ME_EVENT_TAP_QUEUE_SIZE) {
+            file_ = fopen(file_name_.c_str(), "wb");
+            ASSERT(file_ != nullptr, "Unable to open event tap:" + file_name_ + " errno:" + std::string(strerror(errno)));
+
+            const METapHeader header;
+            ASSERT(fwrite(&header, sizeof(header), 1, file_) == 1, "Failed to write event tap:" + file_name_);
+
+            TSCClock::instance();
+            drain_thread_ = createAndStartThread(-1, "Exchange/MEEventTap " + file_name_, [this]() { drain(); });
+            ASSERT(drain_thread_ != nullptr, "Failed to start MEEventTap thread.");
+        }
+
+        /// Everything recorded before this is on disk once it returns.
+        ~MEEventTap() {
+            running_ = false;
+            drain_thread_->join();
+            delete drain_thread_;
+            drain_thread_ = nullptr;
+
+            writeQueued();
+            fclose(file_);
+            file_ = nullptr;
+        }
+
+        /// Spins while the ring is full rather than dropping events, the drainer only falls behind on a stalled disk.
+        template<typename Message>
+        void record(uint64_t seq_num, const Message& message) noexcept {
+            while (!events_.emplace(rdtsc(), seq_num, message));
+        }
+
+        MEEventTap() = delete;
+        MEEventTap(const MEEventTap&) = delete;
+        MEEventTap(const MEEventTap&&) = delete;
+        MEEventTap& operator=(const MEEventTap&) = delete;
+        MEEventTap& operator=(const MEEventTap&&) = delete;
+
+    private:
+        void drain() noexcept {
+            while (running_) {
+                writeQueued();
+                fflush(file_);
+
+                using namespace std::literals::chrono_literals;
+                std::this_thread::sleep_for(10ms);
+            }
+        }
+
+        void writeQueued() noexcept {
+            auto& tsc_clock = TSCClock::instance();
+            tsc_clock.calibrate();
+            if (tsc_clock.version() != calibration_version_) {
+                calibration_version_ = tsc_clock.version();
+                const MEEvent calibration(tsc_clock.calibration());
+                ASSERT(fwrite(&calibration, sizeof(calibration), 1, file_) == 1, "Failed to write event tap:" + file_name_);
+            }
+
+            for (auto events = events_.peekRead(events_.capacity()); !events.empty(); events = events_.peekRead(events_.capacity())) {
+                ASSERT(fwrite(events.data(), sizeof(MEEvent), events.size(), file_) == events.size(), "Failed to write event tap:" + file_name_);
+                events_.releaseRead(events.size());
+            }
+        }
+    };
+}
@@ -4,24 +4,33 @@
 
 namespace Exchange {
 
-MEOrderBook::MEOrderBook(TickerId ticker_id, MatchingEngine* matchine_engine, Logger* logger) :
-ticker_id_(ticker_id), matching_engine_(matchine_engine), logger_(logger), 
-orders_at_price_pool_(ME_MAX_PRICE_LEVELS), order_pool_(ME_MAX_ORDER_IDS) { }
+MEOrderBook::MEOrderBook(TickerId ticker_id, const InstrumentConfig& instrument_config, ExecutionReportMode execution_report_mode,
+                         MatchingEngine* matchine_engine, Logger* logger) :
+ticker_id_(ticker_id), execution_report_mode_(execution_report_mode), matching_engine_(matchine_engine), logger_(logger),
+cid_oid_to_order_(instrument_config.max_orders_, orderBookHugePageConfig(instrument_config)), ladder_(instrument_config),
+order_pool_(instrument_config.max_orders_, HugePageAllocator<MEOrder>(orderBookHugePageConfig(instrument_config))),
+client_order_links_(instrument_config.max_orders_, ClientOrderLink(), HugePageAllocator<ClientOrderLink>(orderBookHugePageConfig(instrument_config))),
+expiry_wheel_(instrument_config.max_orders_, ME_EXPIRY_TICK, HugePageAllocator<TimingWheelNode>(orderBookHugePageConfig(instrument_config))) {
+    client_orders_.fill(nullptr);
+}
 
 MEOrderBook::~MEOrderBook() {
-    logger_->log("%:% %() % OrderBook\n%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+    logger_->log("%:% %() % OrderBook\n%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
                 toString(false, true));
     
     matching_engine_ = nullptr;
-    bids_at_price_ = nullptr;
-    asks_at_price_ = nullptr;
     logger_ = nullptr;
-    for (auto& it: cid_oid_to_order_) {
-        it.fill(nullptr);
-    }
+    cid_oid_to_order_.clear();
 }
 
-void MEOrderBook::add(ClientId client_id, OrderId client_order_id, Side side, Price price, Qty qty) noexcept {
+void MEOrderBook::add(ClientId client_id, OrderId client_order_id, Side side, Price price, Qty qty, Nanos expiry_time) noexcept {
+    // A full book rejects up front, even an order which would not have rested.
+    if (!ladder_.isValidPrice(price) || order_pool_.available() == 0) [[unlikely]] {
+        client_response_ = {ClientResponseType::REJECTED, client_id, ticker_id_, client_order_id, OrderId_INVALID, side, price, 0, qty};
+        matching_engine_->sendClientResponse(client_response_);
+        return;
+    }
+
     const OrderId new_market_order_id = generateNewMarketOrderId();
     client_response_ = {ClientResponseType::ACCEPTED, client_id, ticker_id_, client_order_id, new_market_order_id, side, price, 0, qty};
     matching_engine_->sendClientResponse(client_response_);
@@ -31,9 +40,12 @@ void MEOrderBook::add(ClientId client_id, OrderId client_order_id, Side side, Pr
     if (leaves_qty > 0) [[likely]] {
         const Priority priority = getNextPriority(price);
 
-        MEOrder* order = order_pool_.allocate(ticker_id_, client_order_id, new_market_order_id, client_id, side, price, leaves_qty, priority, nullptr, nullptr);
+        MEOrder* order = order_pool_.allocate(client_order_id, new_market_order_id, client_id, side, price, leaves_qty, priority, nullptr, nullptr);
 
         addOrder(order);
+        if (expiry_time) {
+            expiry_wheel_.schedule(order_pool_.indexOf(order), expiry_time);
+        }
 
         market_update_ = {MarketUpdateType::ADD, new_market_order_id, ticker_id_, side, price, leaves_qty, priority};
         matching_engine_->sendMarketUpdate(market_update_);
@@ -41,20 +53,15 @@ void MEOrderBook::add(ClientId client_id, OrderId client_order_id, Side side, Pr
 }
 
 void MEOrderBook::cancel(ClientId client_id, OrderId client_order_id) noexcept {
-    bool is_cancelable = (client_order_id < cid_oid_to_order_.size());
-    MEOrder* order = nullptr;
-
-    if (is_cancelable) [[likely]] {
-        auto& it = cid_oid_to_order_.at(client_id);
-        order = it.at(client_order_id);
-        is_cancelable = (order != nullptr);
-    }
+    MEOrder* order = cid_oid_to_order_.find(client_id, client_order_id);
 
-    if (is_cancelable) [[likely]] {
+    if (order != nullptr) [[likely]] {
         client_response_ = {ClientResponseType::CANCELED, client_id, ticker_id_, client_order_id, order->market_order_id_, 
         order->side_, order->price_, 0, order->qty_};
         market_update_ = {MarketUpdateType::CANCEL, order->market_order_id_, ticker_id_, order->side_, order->price_, order->qty_, order->priority_};
         matching_engine_->sendMarketUpdate(market_update_);
+
+        removeOrder(order);
     }
     else {
         client_response_ = {ClientResponseType::CANCEL_REJECTED, client_id, ticker_id_, client_order_id, OrderId_INVALID, 
@@ -64,12 +71,156 @@ void MEOrderBook::cancel(ClientId client_id, OrderId client_order_id) noexcept {
     matching_engine_->sendClientResponse(client_response_);
 }
 
+void MEOrderBook::modify(ClientId client_id, OrderId client_order_id, Price price, Qty qty) noexcept {
+    MEOrder* order = cid_oid_to_order_.find(client_id, client_order_id);
+
+    if (order == nullptr || !ladder_.isValidPrice(price) || qty == 0 || qty == Qty_INVALID) [[unlikely]] {
+        client_response_ = {ClientResponseType::MODIFY_REJECTED, client_id, ticker_id_, client_order_id,
+                            order ? order->market_order_id_ : OrderId_INVALID, order ? order->side_ : Side::INVALID, price, Qty_INVALID, qty};
+        matching_engine_->sendClientResponse(client_response_);
+        return;
+    }
+
+    const auto market_order_id = order->market_order_id_;
+    const auto side = order->side_;
+
+    client_response_ = {ClientResponseType::MODIFIED, client_id, ticker_id_, client_order_id, market_order_id, side, price, 0, qty};
+    matching_engine_->sendClientResponse(client_response_);
+
+    if (price == order->price_ && qty <= order->qty_) {
+        // Size down in place, the order keeps its place in the queue.
+        order->qty_ = qty;
+        market_update_ = {MarketUpdateType::MODIFY, market_order_id, ticker_id_, side, price, qty, order->priority_};
+        matching_engine_->sendMarketUpdate(market_update_);
+        return;
+    }
+
+    // A re-priced order that crosses trades first - it leaves the published book while it does, and comes back as an ADD.
+    const bool crosses = crossesBook(side, price);
+    if (crosses) {
+        market_update_ = {MarketUpdateType::CANCEL, market_order_id, ticker_id_, side, order->price_, order->qty_, order->priority_};
+        matching_engine_->sendMarketUpdate(market_update_);
+    }
+
+    const auto expiry_time = orderExpiryTime(order);
+    removeOrder(order);
+
+    const Qty leaves_qty = crosses ? checkForMatch(client_id, client_order_id, ticker_id_, side, price, qty, market_order_id) : qty;
+
+    if (leaves_qty > 0) [[likely]] {
+        const Priority priority = getNextPriority(price);
+
+        order = order_pool_.allocate(client_order_id, market_order_id, client_id, side, price, leaves_qty, priority, nullptr, nullptr);
+        addOrder(order);
+        if (expiry_time) {
+            expiry_wheel_.schedule(order_pool_.indexOf(order), expiry_time);
+        }
+
+        market_update_ = {crosses ? MarketUpdateType::ADD : MarketUpdateType::MODIFY, market_order_id, ticker_id_, side, price, leaves_qty, priority};
+        matching_engine_->sendMarketUpdate(market_update_);
+    }
+}
+
+void MEOrderBook::cancelAll(ClientId client_id, Side side) noexcept {
+    size_t num_canceled = 0;
+    for (MEOrder* order = client_orders_[client_id]; order != nullptr;) {
+        MEOrder* next_order = clientOrderLink(order).next_order_;
+
+        if (side == Side::INVALID || order->side_ == side) {
+            cancelOrder(order);
+            ++num_canceled;
+        }
+
+        order = next_order;
+    }
+
+    logger_->log("%:% %() % Cancelled % orders of client:% ticker:% side:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                 num_canceled, client_id, ticker_id_, static_cast<int>(side));
+}
+
+void MEOrderBook::expireOrders(Nanos now) noexcept {
+    expiry_wheel_.advance(now, [this](auto index) {
+        MEOrder* order = order_pool_.at(index);
+        logger_->log("%:% %() % Expired client:% coid:% moid:% ticker:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                     order->client_id_, order->client_order_id_, order->market_order_id_, ticker_id_);
+        cancelOrder(order);
+    });
+}
+
+void MEOrderBook::cancelOrder(MEOrder* order) noexcept {
+    client_response_ = {ClientResponseType::CANCELED, order->client_id_, ticker_id_, order->client_order_id_, order->market_order_id_,
+                        order->side_, order->price_, 0, order->qty_};
+    matching_engine_->sendClientResponse(client_response_);
+    market_update_ = {MarketUpdateType::CANCEL, order->market_order_id_, ticker_id_, order->side_, order->price_, order->qty_, order->priority_};
+    matching_engine_->sendMarketUpdate(market_update_);
+
+    removeOrder(order);
+}
+
+void MEOrderBook::writeCheckpoint(FILE* file) const noexcept {
+    const MECheckpointBook book{ticker_id_, next_order_id_, order_pool_.capacity() - order_pool_.available()};
+    ASSERT(fwrite(&book, sizeof(book), 1, file) == 1, "Failed to write checkpoint for ticker:" + tickerIdToString(ticker_id_));
+
+    ladder_.forEachOrder([this, file](const MEOrder* order) {
+        const MECheckpointOrder record{order->client_order_id_, order->market_order_id_, order->client_id_, order->side_, order->price_,
+                                       order->qty_, order->priority_, orderExpiryTime(order)};
+        ASSERT(fwrite(&record, sizeof(record), 1, file) == 1, "Failed to write checkpoint for ticker:" + tickerIdToString(ticker_id_));
+    });
+}
+
+void MEOrderBook::loadCheckpoint(FILE* file, const MECheckpointBook& book) noexcept {
+    ASSERT(order_pool_.available() == order_pool_.capacity(), "Checkpoint loaded into non-empty book for ticker:" + tickerIdToString(ticker_id_));
+    ASSERT(book.num_orders_ <= order_pool_.capacity(), "Checkpoint has too many orders for ticker:" + tickerIdToString(ticker_id_) +
+           " orders:" + std::to_string(book.num_orders_));
+
+    next_order_id_ = book.next_order_id_;
+
+    std::vector<MECheckpointOrder> records(ME_CHECKPOINT_READ_BATCH);
+    for (size_t loaded = 0; loaded < book.num_orders_;) {
+        const auto count = std::min(records.size(), book.num_orders_ - loaded);
+        ASSERT(fread(records.data(), sizeof(MECheckpointOrder), count, file) == count, "Truncated checkpoint for ticker:" +
+               tickerIdToString(ticker_id_));
+
+        for (size_t i = 0; i < count; ++i) {
+            const auto &record = records[i];
+            ASSERT(ladder_.isValidPrice(record.price_) && (record.side_ == Side::BUY || record.side_ == Side::SELL),
+                   "Invalid checkpoint order for ticker:" + tickerIdToString(ticker_id_) + " price:" + priceToString(record.price_));
+
+            MEOrder* order = order_pool_.allocate(record.client_order_id_, record.market_order_id_, record.client_id_, record.side_,
+                                                  record.price_, record.qty_, record.priority_, nullptr, nullptr);
+
+            if (const auto orders_at_price = ladder_.getOrdersAtPrice(order->price_)) {
+                ASSERT(orders_at_price->side_ == order->side_ && order->priority_ > orders_at_price->first_order_->prev_order_->priority_,
+                       "Checkpoint level out of priority order:" + order->toString());
+            }
+            ladder_.addOrder(order);
+
+            cid_oid_to_order_.insert(order->client_id_, order->client_order_id_, order);
+            linkClientOrder(order);
+            if (record.expiry_time_) {
+                expiry_wheel_.schedule(order_pool_.indexOf(order), record.expiry_time_);
+            }
+        }
+        loaded += count;
+    }
+
+    logger_->log("%:% %() % Loaded % orders for ticker:% next_order_id:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                 book.num_orders_, tickerIdToString(ticker_id_), next_order_id_);
+}
+
+void MEOrderBook::publishOrders() noexcept {
+    ladder_.forEachOrder([this](const MEOrder* order) {
+        market_update_ = {MarketUpdateType::ADD, order->market_order_id_, ticker_id_, order->side_, order->price_, order->qty_, order->priority_};
+        matching_engine_->sendMarketUpdate(market_update_);
+    });
+}
+
 // Function referred from author's implementation at https://github.com/PacktPublishing/Building-Low-Latency-Applications-with-CPP/blob/fc7061f3435009a5e8d78b2dc189c50b59317d58/Chapter6/exchange/matcher/me_order_book.cpp#L126
 std::string MEOrderBook::toString(bool detailed, bool validity_check) const {
     std::stringstream ss;
     std::string time_str;
 
-    auto printer = [&](std::stringstream &ss, MEOrdersAtPrice *itr, Side side, Price &last_price, bool sanity_check) {
+    auto printer = [&](std::stringstream &ss, const MEOrdersAtPrice *itr, Side side, Price &last_price, bool sanity_check) {
         char buf[4096];
         Qty qty = 0;
         size_t num_orders = 0;
@@ -80,9 +231,8 @@ std::string MEOrderBook::toString(bool detailed, bool validity_check) const {
         if (o_itr->next_order_ == itr->first_order_)
             break;
         }
-        sprintf(buf, " <px:%3s p:%3s n:%3s> %-3s @ %-5s(%-4s)",
-                priceToString(itr->price_).c_str(), priceToString(itr->prev_entry_->price_).c_str(), priceToString(itr->next_entry_->price_).c_str(),
-                priceToString(itr->price_).c_str(), qtyToString(qty).c_str(), std::to_string(num_orders).c_str());
+        sprintf(buf, " <px:%3s> %-3s @ %-5s(%-4s)",
+                priceToString(itr->price_).c_str(), priceToString(itr->price_).c_str(), qtyToString(qty).c_str(), std::to_string(num_orders).c_str());
         ss << buf;
         for (auto o_itr = itr->first_order_;; o_itr = o_itr->next_order_) {
         if (detailed) {
@@ -108,205 +258,132 @@ std::string MEOrderBook::toString(bool detailed, bool validity_check) const {
 
     ss << "Ticker:" << tickerIdToString(ticker_id_) << std::endl;
     {
-      auto ask_itr = asks_at_price_;
       auto last_ask_price = std::numeric_limits<Price>::min();
-      for (size_t count = 0; ask_itr; ++count) {
-        ss << "ASKS L:" << count << " => ";
-        auto next_ask_itr = (ask_itr->next_entry_ == asks_at_price_ ? nullptr : ask_itr->next_entry_);
-        printer(ss, ask_itr, Side::SELL, last_ask_price, validity_check);
-        ask_itr = next_ask_itr;
-      }
+      size_t count = 0;
+      ladder_.asks().forEachLevel([&](const MEOrdersAtPrice& orders_at_price) {
+        ss << "ASKS L:" << count++ << " => ";
+        printer(ss, &orders_at_price, Side::SELL, last_ask_price, validity_check);
+      });
     }
 
     ss << std::endl << "                          X" << std::endl << std::endl;
 
     {
-      auto bid_itr = bids_at_price_;
       auto last_bid_price = std::numeric_limits<Price>::max();
-      for (size_t count = 0; bid_itr; ++count) {
-        ss << "BIDS L:" << count << " => ";
-        auto next_bid_itr = (bid_itr->next_entry_ == bids_at_price_ ? nullptr : bid_itr->next_entry_);
-        printer(ss, bid_itr, Side::BUY, last_bid_price, validity_check);
-        bid_itr = next_bid_itr;
-      }
+      size_t count = 0;
+      ladder_.bids().forEachLevel([&](const MEOrdersAtPrice& orders_at_price) {
+        ss << "BIDS L:" << count++ << " => ";
+        printer(ss, &orders_at_price, Side::BUY, last_bid_price, validity_check);
+      });
     }
 
     return ss.str();
 }
 
-void MEOrderBook::addOrdersAtPrice(MEOrdersAtPrice* new_orders_at_price) {
-    price_orders_at_price_.at(priceToIndex(new_orders_at_price->price_)) = new_orders_at_price;
-    const Side side = new_orders_at_price->side_;
-
-    MEOrdersAtPrice* orders_at_price_it = (side == Side::BUY ? bids_at_price_ : asks_at_price_);
-    if (orders_at_price_it == nullptr) [[unlikely]] {
-        new_orders_at_price->next_entry_ = new_orders_at_price->prev_entry_ = new_orders_at_price;
-        (side == Side::BUY ? bids_at_price_ : asks_at_price_) = new_orders_at_price;
-    }
-    else {
-        MEOrdersAtPrice* const initial_it = orders_at_price_it;     // initial_it used to check loop around of orders_at_price_it
-        MEOrdersAtPrice* add_after_it = nullptr;
-
-        while (orders_at_price_it->next_entry_ != initial_it) {
-            if ((side == Side::BUY && orders_at_price_it->price_ < new_orders_at_price->price_) || 
-                (side == Side::SELL && orders_at_price_it->price_ > new_orders_at_price->price_)) break;
-            
-            add_after_it = orders_at_price_it;
-            orders_at_price_it = orders_at_price_it->next_entry_;
-        }
-
-        if (add_after_it == nullptr) {
-            /* Two possibilities:
-                1. There is only one price level and new_orders_at_price is inserted before/after this
-                2. There are >1 price levels and new_orders_at_price is inserted at start of linked list
-            */
-            if (orders_at_price_it->next_entry_ == initial_it) {
-                new_orders_at_price->next_entry_ = new_orders_at_price->prev_entry_ = orders_at_price_it;
-                orders_at_price_it->prev_entry_ = orders_at_price_it->next_entry_ = new_orders_at_price;
-                if ((side == Side::BUY && orders_at_price_it->price_ < new_orders_at_price->price_) || 
-                    (side == Side::SELL && orders_at_price_it->price_ > new_orders_at_price->price_)) {
-                        (side == Side::BUY ? bids_at_price_ : asks_at_price_) = new_orders_at_price;
-                    }
-            }
-            else {
-                new_orders_at_price->prev_entry_ = orders_at_price_it->prev_entry_;
-                new_orders_at_price->next_entry_ = orders_at_price_it;
-                orders_at_price_it->prev_entry_ = new_orders_at_price;
-                new_orders_at_price->prev_entry_->next_entry_ = new_orders_at_price;
-
-                (side == Side::BUY ? bids_at_price_ : asks_at_price_) = new_orders_at_price;
-            }
-        } 
-        else {
-            new_orders_at_price->prev_entry_ = add_after_it;
-            new_orders_at_price->next_entry_ = add_after_it->next_entry_;
-            add_after_it->next_entry_ = new_orders_at_price;
-            new_orders_at_price->next_entry_->prev_entry_ = new_orders_at_price;
-        }
-    }
-}
-
-void MEOrderBook::removeOrdersAtPrice(Side side, Price price) {
-    MEOrdersAtPrice* best_orders_of_side = (side == Side::BUY ? bids_at_price_ : asks_at_price_);
-    MEOrdersAtPrice* orders_at_price = getOrdersAtPrice(price);
-
-    if (best_orders_of_side->next_entry_ == best_orders_of_side) {
-        (side == Side::BUY ? bids_at_price_ : asks_at_price_) = nullptr;
-    }
-    else {
-        orders_at_price->prev_entry_->next_entry_ = orders_at_price->next_entry_;
-        orders_at_price->next_entry_->prev_entry_ = orders_at_price->prev_entry_;
-
-        if (best_orders_of_side == orders_at_price) {
-            (side == Side::BUY ? bids_at_price_ : asks_at_price_) = orders_at_price->next_entry_;
-        }
-    }
-
-    orders_at_price->prev_entry_ = orders_at_price->next_entry_ = nullptr;
-    price_orders_at_price_.at(priceToIndex(price)) = nullptr;
+template<Side S>
+void MEOrderBook::sendExecution(TickerId ticker_id, ClientId client_id, OrderId client_order_id, OrderId new_market_order_id, Price exec_price,
+                                Qty exec_qty, Qty leaves_qty) noexcept {
+    client_response_ = {ClientResponseType::FILLED, client_id, ticker_id, client_order_id, new_market_order_id, S, exec_price, exec_qty, leaves_qty};
+    matching_engine_->sendClientResponse(client_response_);
 
-    orders_at_price_pool_.deallocate(orders_at_price);
+    market_update_ = {MarketUpdateType::TRADE, OrderId_INVALID, ticker_id_, S, exec_price, exec_qty, Priority_INVALID};
+    matching_engine_->sendMarketUpdate(market_update_);
 }
 
-void MEOrderBook::match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* matched_order, Qty& leaves_qty) noexcept {
+template<Side S, ExecutionReportMode M>
+void MEOrderBook::match(TickerId ticker_id, ClientId client_id, OrderId client_order_id, OrderId new_market_order_id, MEOrder* matched_order, Qty& leaves_qty) noexcept {
+    constexpr auto resting_side = SidePolicy<S>::OPPOSITE;
     const auto exec_qty = std::min(leaves_qty, matched_order->qty_);
     const auto exec_price = matched_order->price_;
 
     leaves_qty -= exec_qty;
     matched_order->qty_ -= exec_qty;
 
-    client_response_ = {ClientResponseType::FILLED, client_id, ticker_id, client_order_id, new_market_order_id, side, exec_price, exec_qty, leaves_qty};
-    matching_engine_->sendClientResponse(client_response_);
+    if constexpr (M == ExecutionReportMode::PER_FILL) {
+        client_response_ = {ClientResponseType::FILLED, client_id, ticker_id, client_order_id, new_market_order_id, S, exec_price, exec_qty, leaves_qty};
+        matching_engine_->sendClientResponse(client_response_);
+    }
 
     client_response_ = {ClientResponseType::FILLED, matched_order->client_id_, ticker_id, matched_order->client_order_id_, 
-                        matched_order->market_order_id_, matched_order->side_, exec_price, exec_qty, matched_order->qty_};
+                        matched_order->market_order_id_, resting_side, exec_price, exec_qty, matched_order->qty_};
     matching_engine_->sendClientResponse(client_response_);
 
-    market_update_ = {MarketUpdateType::TRADE, OrderId_INVALID, ticker_id_, side, exec_price, exec_qty, Priority_INVALID};
-    matching_engine_->sendMarketUpdate(market_update_);
+    if constexpr (M == ExecutionReportMode::PER_FILL) {
+        market_update_ = {MarketUpdateType::TRADE, OrderId_INVALID, ticker_id_, S, exec_price, exec_qty, Priority_INVALID};
+        matching_engine_->sendMarketUpdate(market_update_);
+    }
 
     if (matched_order->qty_ > 0) {
-        market_update_ = {MarketUpdateType::MODIFY, matched_order->market_order_id_, ticker_id_, matched_order->side_, exec_price, matched_order->qty_, matched_order->priority_};
+        market_update_ = {MarketUpdateType::MODIFY, matched_order->market_order_id_, ticker_id_, resting_side, exec_price, matched_order->qty_, matched_order->priority_};
         matching_engine_->sendMarketUpdate(market_update_);
     }
     else {
-        market_update_ = {MarketUpdateType::CANCEL, matched_order->market_order_id_, ticker_id_, matched_order->side_, exec_price, matched_order->qty_, Priority_INVALID};
+        market_update_ = {MarketUpdateType::CANCEL, matched_order->market_order_id_, ticker_id_, resting_side, exec_price, matched_order->qty_, Priority_INVALID};
         matching_engine_->sendMarketUpdate(market_update_);
 
-        removeOrder(matched_order);
+        removeOrder<resting_side>(matched_order);
     }
 }
 
-Qty MEOrderBook::checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty, OrderId new_market_order_id) noexcept {
-    Qty leaves_qty = qty;
-    switch (side) {
-        case Side::BUY:
-            while (leaves_qty > 0 && asks_at_price_ != nullptr) {
-                MEOrder* top_ask = asks_at_price_->first_order_;
+template<Side S, ExecutionReportMode M>
+Qty MEOrderBook::checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Price price, Qty qty, OrderId new_market_order_id) noexcept {
+    const auto& resting_side = ladder_.side<SidePolicy<S>::OPPOSITE>();
 
-                if (top_ask->price_ > price) break;
+    Qty leaves_qty = qty;
+    while (leaves_qty > 0 && resting_side.crossedBy(price)) {
+        if constexpr (M == ExecutionReportMode::PER_FILL) {
+            match<S, M>(ticker_id, client_id, client_order_id, new_market_order_id, resting_side.best()->first_order_, leaves_qty);
+        }
+        else {
+            // The level stops being the best one when its last order fills.
+            const auto orders_at_price = resting_side.best();
+            const auto level_price = orders_at_price->price_;
+            const auto level_start_qty = leaves_qty;
+            do {
+                match<S, M>(ticker_id, client_id, client_order_id, new_market_order_id, orders_at_price->first_order_, leaves_qty);
+            } while (leaves_qty > 0 && resting_side.best() == orders_at_price);
+
+            sendExecution<S>(ticker_id, client_id, client_order_id, new_market_order_id, level_price, level_start_qty - leaves_qty, leaves_qty);
+        }
+    }
 
-                match(ticker_id, client_id, side, client_order_id, new_market_order_id, top_ask, leaves_qty);
-            }
-        break;
+    return leaves_qty;
+}
 
+Qty MEOrderBook::checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty, OrderId new_market_order_id) noexcept {
+    const bool per_level = (execution_report_mode_ == ExecutionReportMode::PER_LEVEL);
+    switch (side) {
+        case Side::BUY:
+            return per_level ? checkForMatch<Side::BUY, ExecutionReportMode::PER_LEVEL>(client_id, client_order_id, ticker_id, price, qty, new_market_order_id) :
+                               checkForMatch<Side::BUY, ExecutionReportMode::PER_FILL>(client_id, client_order_id, ticker_id, price, qty, new_market_order_id);
         case Side::SELL:
-            while (leaves_qty > 0 && bids_at_price_ != nullptr) {
-                MEOrder* top_bid = bids_at_price_->first_order_;
-
-                if (top_bid->price_ < price) break;
-
-                match(ticker_id, client_id, side, client_order_id, new_market_order_id, top_bid, leaves_qty);
-            }
-        break;
-        
+            return per_level ? checkForMatch<Side::SELL, ExecutionReportMode::PER_LEVEL>(client_id, client_order_id, ticker_id, price, qty, new_market_order_id) :
+                               checkForMatch<Side::SELL, ExecutionReportMode::PER_FILL>(client_id, client_order_id, ticker_id, price, qty, new_market_order_id);
         default:
             FATAL("Received invalid client-request-side:" + sideToString(side));
     }
 
-    return leaves_qty;
+    return 0;
 }
 
 void MEOrderBook::addOrder(MEOrder* order) noexcept {
-    MEOrdersAtPrice* orders_at_price = getOrdersAtPrice(order->price_);
-
-    if (orders_at_price == nullptr) {
-        order->next_order_ = order->prev_order_ = order;
-
-        MEOrdersAtPrice* new_orders_at_price = orders_at_price_pool_.allocate(order->side_, order->price_, order, nullptr, nullptr);
-        addOrdersAtPrice(new_orders_at_price);
-    }
-    else {
-        auto first_order = orders_at_price->first_order_;
-        first_order->prev_order_->next_order_ = order;
-        order->prev_order_ = first_order->prev_order_;
-        first_order->prev_order_ = order;
-        order->next_order_ = first_order;
-    }
+    ladder_.addOrder(order);
 
-    cid_oid_to_order_.at(order->client_id_).at(order->client_order_id_) = order;
+    cid_oid_to_order_.insert(order->client_id_, order->client_order_id_, order);
+    linkClientOrder(order);
 }
 
+template<Side S>
 void MEOrderBook::removeOrder(MEOrder* order) noexcept {
-    MEOrdersAtPrice* orders_at_price = getOrdersAtPrice(order->price_);
-
-    if (order->next_order_ == order) {   // Only order at the price level
-        removeOrdersAtPrice(orders_at_price->side_, orders_at_price->price_);
-    }
-    else {
-        order->prev_order_->next_order_ = order->next_order_;
-        order->next_order_->prev_order_ = order->prev_order_;
-        
-        if (orders_at_price->first_order_ == order) {
-            orders_at_price->first_order_ = order->next_order_;
-        }
-    }
-
-    order->next_order_ = order->prev_order_ = nullptr;
-    cid_oid_to_order_.at(order->client_id_).at(order->client_order_id_) = nullptr;
+    ladder_.removeOrder<S>(order);
+    cid_oid_to_order_.erase(order->client_id_, order->client_order_id_);
+    unlinkClientOrder(order);
+    expiry_wheel_.cancel(order_pool_.indexOf(order));
     order_pool_.deallocate(order);
 }
 
+void MEOrderBook::removeOrder(MEOrder* order) noexcept {
+    order->side_ == Side::BUY ? removeOrder<Side::BUY>(order) : removeOrder<Side::SELL>(order);
 }
 
-
+}
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdio>
+
 #include "common/mem_pool.hpp"
+#include "common/huge_page_allocator.hpp"
+#include "common/price_ladder.hpp"
+#include "common/timing_wheel.hpp"
 #include "common/logger.hpp"
 #include "common/macros.hpp"
 #include "common/types.hpp"
@@ -8,44 +13,113 @@
 #include "order_server/client_response.hpp"
 
 #include "matching_engine/me_order.hpp"
+#include "matching_engine/me_client_order_map.hpp"
+#include "matching_engine/me_checkpoint.hpp"
 
 using namespace Common;
 
 namespace Exchange {
+    /// Resolution of good-till-time expiries.
+    constexpr Nanos ME_EXPIRY_TICK = 1 * NANOS_TO_MILLIS;
+
+    /// How the executions of an aggressive order are reported. Resting orders always get one FILLED and one MODIFY / CANCEL
+    /// update per fill.
+    enum class ExecutionReportMode : uint8_t {
+        PER_FILL = 0,   // a FILLED to the aggressor and a TRADE for every resting order it fills.
+        PER_LEVEL = 1   // one FILLED to the aggressor and one TRADE for every price level it sweeps, at that level's price.
+    };
+
+    inline std::string executionReportModeToString(ExecutionReportMode mode) {
+        switch (mode) {
+            case ExecutionReportMode::PER_FILL:
+                return "PER_FILL";
+            case ExecutionReportMode::PER_LEVEL:
+                return "PER_LEVEL";
+        }
+
+        return "UNKNOWN";
+    }
+
+    /// Memory of the per order arrays of a book. Each array is a mapping of its own, so a book whose order pool fits in less
+    /// than a huge page uses regular pages faulted in on first touch instead of six prefaulted 2MB mappings.
+    inline auto orderBookHugePageConfig(const InstrumentConfig& instrument_config) noexcept {
+        HugePageConfig config;
+        if (instrument_config.max_orders_ * sizeof(MEOrder) < hugePageBytes(HugePageSize::HUGE_2MB)) {
+            config.page_size_ = HugePageSize::NONE;
+            config.prefault_ = false;
+        }
+        return config;
+    }
+
     class MatchingEngine;
 
     class MEOrderBook final {
     private:
         TickerId ticker_id_ = TickerId_INVALID;
+        ExecutionReportMode execution_report_mode_ = ExecutionReportMode::PER_FILL;
 
         MatchingEngine* matching_engine_ = nullptr;
         Logger* logger_ = nullptr;
 
         ClientOrderHashMap cid_oid_to_order_;
 
-        MemPool<MEOrdersAtPrice> orders_at_price_pool_;
-        MEOrdersAtPrice* bids_at_price_ = nullptr;
-        MEOrdersAtPrice* asks_at_price_ = nullptr;
+        PriceLadder<MEOrdersAtPrice> ladder_;
+
+        MemPool<MEOrder, HugePageAllocator<MEOrder>> order_pool_;
 
-        OrdersAtPriceHashMap price_orders_at_price_;
+        // Intrusive list of each client's resting orders. The links live in a side array parallel to order_pool_ so that
+        // MEOrder stays one cache line, they are only touched when an order is added, removed or mass cancelled.
+        struct ClientOrderLink {
+            MEOrder* prev_order_ = nullptr;
+            MEOrder* next_order_ = nullptr;
+        };
+        std::vector<ClientOrderLink, HugePageAllocator<ClientOrderLink>> client_order_links_;
+        std::array<MEOrder*, ME_MAX_NUM_CLIENTS> client_orders_;
 
-        MemPool<MEOrder> order_pool_;
+        // Expiry timers of good-till-time orders, keyed by the order's index in order_pool_.
+        TimingWheel<HugePageAllocator<TimingWheelNode>> expiry_wheel_;
 
         MEClientResponse client_response_;
         MEMarketUpdate market_update_;
         
         OrderId next_order_id_ = 1;
-        std::string time_str_;
 
     public:
-        explicit MEOrderBook(TickerId ticker_id, MatchingEngine* matchine_engine, Logger* logger);
+        explicit MEOrderBook(TickerId ticker_id, const InstrumentConfig& instrument_config, ExecutionReportMode execution_report_mode,
+                             MatchingEngine* matchine_engine, Logger* logger);
         ~MEOrderBook();
 
         std::string toString(bool detailed, bool validity_check) const;
 
-        void add(ClientId client_id, OrderId client_order_id, Side side, Price price, Qty qty) noexcept;
+        /// An expiry_time other than 0 cancels whatever of the order is still resting once expireOrders() reaches it.
+        void add(ClientId client_id, OrderId client_order_id, Side side, Price price, Qty qty, Nanos expiry_time) noexcept;
         void cancel(ClientId client_id, OrderId client_order_id) noexcept;
 
+        /// Amends a resting order. Reducing qty at the same price keeps its priority, any other amend re-queues it at the back of
+        /// the new price level under the same market order id, matching first if the new price crosses the book.
+        void modify(ClientId client_id, OrderId client_order_id, Price price, Qty qty) noexcept;
+
+        /// Cancels every resting order of the client on side (both sides if Side::INVALID), walking only that client's orders.
+        void cancelAll(ClientId client_id, Side side) noexcept;
+
+        /// Moves the book's time forward to now, cancelling the orders expiring on the way.
+        void expireOrders(Nanos now) noexcept;
+
+        /// Earliest time expireOrders() has work to do.
+        auto nextExpiryTime() const noexcept {
+            return expiry_wheel_.nextDeadline();
+        }
+
+        /// Appends this book's section to a checkpoint.
+        void writeCheckpoint(FILE* file) const noexcept;
+
+        /// Bulk loads a section written by writeCheckpoint() into this empty book. Orders arrive grouped by level in priority
+        /// order, so every one is simply queued at the back of its level without going through add().
+        void loadCheckpoint(FILE* file, const MECheckpointBook& book) noexcept;
+
+        /// Sends an ADD market update for every resting order, in the same order as they are checkpointed.
+        void publishOrders() noexcept;
+
         MEOrderBook() = delete;
         MEOrderBook(const MEOrderBook&) = delete;
         MEOrderBook(const MEOrderBook&&) = delete;
@@ -57,32 +131,73 @@ namespace Exchange {
             return next_order_id_++;
         }
 
-        auto priceToIndex(Price price) const {
-            return (price % ME_MAX_PRICE_LEVELS);
-        } 
+        auto orderExpiryTime(const MEOrder* order) const noexcept -> Nanos {
+            const auto index = order_pool_.indexOf(order);
+            return expiry_wheel_.isScheduled(index) ? expiry_wheel_.deadline(index) : 0;
+        }
 
-        MEOrdersAtPrice* getOrdersAtPrice(Price price) const {
-            return price_orders_at_price_[priceToIndex(price)];
+        /// Cancels a resting order on the exchange's initiative, with the same response and market update as a client cancel.
+        void cancelOrder(MEOrder* order) noexcept;
+
+        ClientOrderLink& clientOrderLink(const MEOrder* order) noexcept {
+            return client_order_links_[order_pool_.indexOf(order)];
         }
 
-        void addOrdersAtPrice(MEOrdersAtPrice* new_orders_at_price);
+        void linkClientOrder(MEOrder* order) noexcept {
+            auto& first_order = client_orders_[order->client_id_];
+            clientOrderLink(order) = {nullptr, first_order};
+            if (first_order) {
+                clientOrderLink(first_order).prev_order_ = order;
+            }
+            first_order = order;
+        }
 
-        void removeOrdersAtPrice(Side side, Price price);
+        void unlinkClientOrder(MEOrder* order) noexcept {
+            const auto link = clientOrderLink(order);
+            if (link.prev_order_) {
+                clientOrderLink(link.prev_order_).next_order_ = link.next_order_;
+            }
+            else {
+                client_orders_[order->client_id_] = link.next_order_;
+            }
+            if (link.next_order_) {
+                clientOrderLink(link.next_order_).prev_order_ = link.prev_order_;
+            }
+        }
 
         Priority getNextPriority(Price price) noexcept {
-            const auto orders_at_price = getOrdersAtPrice(price);
+            const auto orders_at_price = ladder_.getOrdersAtPrice(price);
             if (!orders_at_price)
                 return 1lu;
 
             return orders_at_price->first_order_->prev_order_->priority_ + 1;
         }
 
-        void match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* matched_order, Qty& leaves_qty) noexcept;
+        template<Side S, ExecutionReportMode M>
+        void match(TickerId ticker_id, ClientId client_id, OrderId client_order_id, OrderId new_market_order_id, MEOrder* matched_order, Qty& leaves_qty) noexcept;
+
+        /// Reports exec_qty of an aggressive order executed at exec_price, to its owner and as a TRADE on the feed.
+        template<Side S>
+        void sendExecution(TickerId ticker_id, ClientId client_id, OrderId client_order_id, OrderId new_market_order_id, Price exec_price,
+                           Qty exec_qty, Qty leaves_qty) noexcept;
+
+        /// Matches an order of side S against the opposite side, best level first. Specialised per side and report mode, so
+        /// the matching loop itself never branches on either.
+        template<Side S, ExecutionReportMode M>
+        Qty checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Price price, Qty qty, OrderId new_market_order_id) noexcept;
 
         Qty checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty, OrderId new_market_order_id) noexcept;
 
+        /// True if an order of side at price would trade on arrival.
+        auto crossesBook(Side side, Price price) const noexcept {
+            return side == Side::BUY ? ladder_.asks().crossedBy(price) : ladder_.bids().crossedBy(price);
+        }
+
         void addOrder(MEOrder* order) noexcept;
 
+        template<Side S>
+        void removeOrder(MEOrder* order) noexcept;
+
         void removeOrder(MEOrder* order) noexcept;
     };
 
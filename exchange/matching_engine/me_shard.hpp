@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "common/macros.hpp"
+#include "common/time_utils.hpp"
+#include "common/types.hpp"
+
+#include "order_server/client_request.hpp"
+#include "order_server/client_response.hpp"
+#include "market_data/market_update.hpp"
+
+namespace Exchange {
+    constexpr size_t ME_MAX_SHARDS = 64;
+
+    /// Queues and progress watermarks connecting one matching engine shard to the order server and market data threads.
+    struct MEShardChannels {
+        MESequencedClientRequestLFQueue client_requests_;
+        MESequencedClientResponseLFQueue client_responses_;
+        MEMarketUpdateBroadcastQueue market_updates_;
+
+        // Written by the FIFOSequencer - every request routed to this shard with a lower sequence number is in client_requests_.
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> routed_seq_num_ = {0};
+
+        // Written by the shard - every output of requests with a lower sequence number is in client_responses_ / market_updates_.
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> done_seq_num_ = {0};
+
+        // Written by the shard - the earliest time it has order expiries to run, the FIFOSequencer sends it a TIMER then.
+        alignas(CACHE_LINE_SIZE) std::atomic<Nanos> next_expiry_time_ = {std::numeric_limits<Nanos>::max()};
+
+        // Written by the shard - the sequence number its checkpoint on disk resumes from, 0 without one. The FIFOSequencer drops
+        // the journal records below the lowest of these.
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> checkpointed_seq_num_ = {0};
+
+        MEShardChannels() : client_requests_(ME_MAX_CLIENT_UPDATES), client_responses_(ME_MAX_CLIENT_UPDATES),
+                market_updates_(ME_MAX_MARKET_UPDATES) {
+        }
+
+        MEShardChannels(const MEShardChannels&) = delete;
+        MEShardChannels(const MEShardChannels&&) = delete;
+        MEShardChannels& operator=(const MEShardChannels&) = delete;
+        MEShardChannels& operator=(const MEShardChannels&&) = delete;
+    };
+
+    typedef std::vector<MEShardChannels*> MEShardChannelsList;
+
+    inline auto shardOf(TickerId ticker_id, size_t num_shards) noexcept {
+        return static_cast<size_t>(ticker_id) % num_shards;
+    }
+
+    /// Hands on_output every shard output that can already be placed in global request sequence order, in that order, and
+    /// returns how many were handed out. An output is released once no other shard can still produce one for an earlier
+    /// request - either its next unread output is for a later request, or it has nothing unread and its done_seq_num_ is past.
+    /// peek(shard) returns the unread outputs of a shard, release(shard, n) consumes the first n of them.
+    template<typename Peek, typename Release, typename OnOutput>
+    size_t mergeShardOutputs(const MEShardChannelsList& shards, Peek&& peek, Release&& release, OnOutput&& on_output) noexcept {
+        using Outputs = decltype(peek(size_t{0}));
+
+        const auto num_shards = shards.size();
+        std::array<size_t, ME_MAX_SHARDS> done_seq_nums;
+        std::array<Outputs, ME_MAX_SHARDS> outputs;
+        size_t merged = 0;
+
+        while (true) {
+            // Watermark before the queue, so the outputs of every request below the watermark are visible to peek().
+            auto next_shard = num_shards;
+            for (size_t i = 0; i < num_shards; ++i) {
+                done_seq_nums[i] = shards[i]->done_seq_num_.load(std::memory_order_acquire);
+                outputs[i] = peek(i);
+                if (!outputs[i].empty() && (next_shard == num_shards || outputs[i].front().seq_num_ < outputs[next_shard].front().seq_num_)) {
+                    next_shard = i;
+                }
+            }
+            if (next_shard == num_shards) {
+                break;
+            }
+
+            auto bound = std::numeric_limits<size_t>::max();
+            for (size_t i = 0; i < num_shards; ++i) {
+                if (i != next_shard) {
+                    bound = std::min(bound, outputs[i].empty() ? done_seq_nums[i] : outputs[i].front().seq_num_);
+                }
+            }
+
+            size_t count = 0;
+            for (const auto &output : outputs[next_shard]) {
+                if (output.seq_num_ >= bound) {
+                    break;
+                }
+                on_output(output);
+                ++count;
+            }
+            if (count == 0) {
+                break;
+            }
+            release(next_shard, count);
+            merged += count;
+        }
+
+        return merged;
+    }
+}
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <sstream>
 
 #include "common/types.hpp"
+#include "common/time_utils.hpp"
 #include "common/lf_queue.hpp"
+#include "common/huge_page_allocator.hpp"
 
 using namespace Common;
 
@@ -13,6 +16,12 @@ namespace Exchange {
         INVALID = 0,
         NEW = 1,
         CANCEL = 2,
+        MODIFY = 3,     // amends price_ / qty_ of the resting order client_order_id_, side_ is ignored.
+        BULK = 4,       // wire only, see PubClientBulkRequest.
+        CANCEL_ALL = 5, // cancels the client's orders on ticker_id_ (every ticker if invalid) on side_ (both if invalid).
+        TIMER = 6,      // generated by the FIFOSequencer, moves the shard owning ticker_id_ forward to the request's time.
+        CANCEL_ALL_SHARD = 7,   // generated by the OrderServer for a CANCEL_ALL for every ticker, one per shard - cancels the
+                                // client's orders on side_ (both if invalid) on every ticker of the shard owning ticker_id_.
     };
 
     inline std::string clientRequestTypeToString(ClientRequestType type) {
@@ -23,6 +32,16 @@ namespace Exchange {
                 return "NEW";
             case ClientRequestType::CANCEL:
                 return "CANCEL";
+            case ClientRequestType::MODIFY:
+                return "MODIFY";
+            case ClientRequestType::BULK:
+                return "BULK";
+            case ClientRequestType::CANCEL_ALL:
+                return "CANCEL_ALL";
+            case ClientRequestType::TIMER:
+                return "TIMER";
+            case ClientRequestType::CANCEL_ALL_SHARD:
+                return "CANCEL_ALL_SHARD";
         }
 
         return "UNKNOWN";
@@ -36,6 +55,7 @@ namespace Exchange {
         Side side_ = Side::INVALID;
         Price price_ = Price_INVALID;
         Qty qty_ = Qty_INVALID;
+        Nanos expiry_time_ = 0;     // NEW orders resting at this time are cancelled, 0 is good till cancelled.
 
         auto toString() const {
             std::stringstream ss;
@@ -47,6 +67,7 @@ namespace Exchange {
                 << " side:" << sideToString(side_)
                 << " qty:" << qtyToString(qty_)
                 << " price:" << priceToString(price_)
+                << " expiry:" << expiry_time_
                 << "]";
             return ss.str();
         }
@@ -66,7 +87,58 @@ namespace Exchange {
         }
     };
 
+    constexpr size_t ME_MAX_BULK_REQUESTS = 64;
+
+    /// Up to ME_MAX_BULK_REQUESTS NEW / CANCEL / MODIFY requests of one client in one message, taking a single client sequence
+    /// number. Only the first num_requests_ entries of requests_ are sent, type_ sits where it does in a PubClientRequest so
+    /// the receiver can tell the two apart. The entries are sequenced back to back and their client_id_ is ignored.
+    struct PubClientBulkRequest {
+        size_t seq_num_ = 0;
+        ClientRequestType type_ = ClientRequestType::BULK;
+        ClientId client_id_ = ClientId_INVALID;
+        uint16_t num_requests_ = 0;
+        MEClientRequest requests_[ME_MAX_BULK_REQUESTS];
+
+        static constexpr size_t headerSize() noexcept {
+            return offsetof(PubClientBulkRequest, requests_);
+        }
+
+        auto size() const noexcept {
+            return headerSize() + num_requests_ * sizeof(MEClientRequest);
+        }
+
+        std::string toString() const noexcept {
+            std::stringstream ss;
+            ss << "PubClientBulkRequest["
+                << "seq:" << seq_num_
+                << " client:" << clientIdToString(client_id_)
+                << " num_requests:" << num_requests_
+                << "]";
+            return ss.str();
+        }
+    };
+
+    static_assert(offsetof(PubClientBulkRequest, type_) == offsetof(PubClientRequest, me_client_request_) + offsetof(MEClientRequest, type_));
+
     #pragma pack(pop)
 
-    typedef LFQueue<MEClientRequest> ClientRequestLFQueue;
+    /// MEClientRequest stamped by the FIFOSequencer with its position in the global request sequence.
+    struct MESequencedClientRequest {
+        size_t seq_num_ = 0;
+        Nanos recv_time_ = 0;
+        MEClientRequest me_client_request_;
+
+        std::string toString() const noexcept {
+            std::stringstream ss;
+            ss << "MESequencedClientRequest["
+                << "seq:" << seq_num_
+                << " rx:" << recv_time_
+                << " " << me_client_request_.toString()
+                << "]";
+            return ss.str();
+        }
+    };
+
+    typedef LFQueue<MEClientRequest, HugePageAllocator<MEClientRequest>> ClientRequestLFQueue;
+    typedef LFQueue<MESequencedClientRequest, HugePageAllocator<MESequencedClientRequest>> MESequencedClientRequestLFQueue;
 }
\ No newline at end of file
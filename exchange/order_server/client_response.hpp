@@ -4,6 +4,7 @@
 
 #include "common/types.hpp"
 #include "common/lf_queue.hpp"
+#include "common/huge_page_allocator.hpp"
 
 using namespace Common;
 
@@ -15,7 +16,9 @@ namespace Exchange {
         CANCELED = 2,
         FILLED = 3,
         CANCEL_REJECTED = 4,
-        REJECTED = 5
+        REJECTED = 5,
+        MODIFIED = 6,
+        MODIFY_REJECTED = 7
     };
 
     inline std::string clientResponseTypeToString(ClientResponseType type) {
@@ -32,6 +35,10 @@ namespace Exchange {
                 return "CANCEL_REJECTED";
             case ClientResponseType::REJECTED:
                 return "REJECTED";
+            case ClientResponseType::MODIFIED:
+                return "MODIFIED";
+            case ClientResponseType::MODIFY_REJECTED:
+                return "MODIFY_REJECTED";
         }
 
         return "UNKNOWN";
@@ -81,5 +88,12 @@ namespace Exchange {
 
     #pragma pack(pop)
 
-    typedef LFQueue<MEClientResponse> ClientResponseLFQueue;
+    /// MEClientResponse tagged with the sequence number of the request that produced it.
+    struct MESequencedClientResponse {
+        size_t seq_num_ = 0;
+        MEClientResponse me_client_response_;
+    };
+
+    typedef LFQueue<MEClientResponse, HugePageAllocator<MEClientResponse>> ClientResponseLFQueue;
+    typedef LFQueue<MESequencedClientResponse, HugePageAllocator<MESequencedClientResponse>> MESequencedClientResponseLFQueue;
 }
\ No newline at end of file
@@ -1,63 +1,203 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <limits>
+
 #include "common/time_utils.hpp"
 #include "common/types.hpp"
 
 #include "order_server/client_request.hpp"
+#include "order_server/journal_replayer.hpp"
+#include "matching_engine/me_shard.hpp"
 
 namespace Exchange
 {
 constexpr size_t ME_MAX_PENDING_REQUESTS = 1024;
+
+/// Puts the requests received on all connections into one sequence by receive time, and publishes it to the matching
+/// engine shards. Requests of a connection arrive in receive time order already, so they are kept as a run per connection
+/// and the runs k-way merged through a heap of their heads, O(n log k) instead of sorting everything. Ties are broken by
+/// the order requests were added in, exactly as a stable sort would. With a fairness window, requests are held until
+/// they are that old, so a request which reached the kernel earlier but was read in a later poll is still sequenced first.
 class FIFOSequencer {
+public:
+    /// Source of the TIMER requests added by addExpiryTimers(), the client request sources are connection ids >= 0.
+    static constexpr int TIMER_SOURCE = -1;
+
 private:
-    ClientRequestLFQueue* incoming_requests_ = nullptr;
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    MEShardChannelsList shards_;
+    MEClientRequestJournalWriter* journal_ = nullptr;
+    size_t next_seq_num_ = 1;
+    const Nanos fairness_window_ = 0;
 
-    std::string time_str_;
     Logger* logger_ = nullptr;
 
     struct RecvTimeClientRequest {
         Nanos recv_time_;
         MEClientRequest me_client_request_;
+    };
+
+    // Pending requests linked into their runs, free slots into free_head_.
+    struct PendingClientRequest {
+        RecvTimeClientRequest request_;
+        uint64_t arrival_ = 0;
+        uint32_t next_ = NONE;
+    };
+    std::array<PendingClientRequest, ME_MAX_PENDING_REQUESTS> pending_client_requests_;
+    uint32_t free_head_ = 0;
+    size_t pending_size_ = 0;
+    uint64_t next_arrival_ = 0;
+
+    // Requests of one source in non-decreasing receive time, oldest first. Every run holds at least one pending request, so
+    // there are never more runs than pending requests, however many connections are open.
+    struct Run {
+        int source_ = TIMER_SOURCE;
+        uint32_t head_ = NONE;
+        uint32_t tail_ = NONE;
+    };
+    std::array<Run, ME_MAX_PENDING_REQUESTS> runs_;
+    size_t num_runs_ = 0;
+    size_t last_run_ = 0;
+
+    // Min-heap of the run heads on (receive time, arrival), rebuilt by every sequenceAndPublish().
+    struct RunHead {
+        Nanos recv_time_;
+        uint64_t arrival_;
+        uint32_t run_;
 
-        bool operator<(const RecvTimeClientRequest& other) {
-            return this->recv_time_ < other.recv_time_;
+        bool operator>(const RunHead& other) const {
+            return recv_time_ != other.recv_time_ ? recv_time_ > other.recv_time_ : arrival_ > other.arrival_;
         }
     };
+    std::array<RunHead, ME_MAX_PENDING_REQUESTS> run_heads_;
 
-    std::array<RecvTimeClientRequest, ME_MAX_PENDING_REQUESTS> pending_client_requests_;
-    size_t pending_size_ = 0;
+    // The requests released from the pending ones, in sequence order. Those from next_ordered_ on did not fit into their
+    // shard's ring yet, and are published before any more are released.
+    std::array<RecvTimeClientRequest, ME_MAX_PENDING_REQUESTS> ordered_client_requests_;
+    size_t num_ordered_ = 0;
+    size_t next_ordered_ = 0;
+
+    // Expiry time of each shard a TIMER has already been queued for.
+    std::array<Nanos, ME_MAX_SHARDS> timer_expiry_times_ = {};
+
+    /// The run of source a request received at rx_time can be appended to, a new one if it has none or its receive times
+    /// went backwards.
+    auto& runFor(int source, Nanos rx_time) {
+        const auto fits = [&](const Run& run) {
+            return run.source_ == source && pending_client_requests_[run.tail_].request_.recv_time_ <= rx_time;
+        };
+        if (last_run_ < num_runs_ && fits(runs_[last_run_])) [[likely]] {
+            return runs_[last_run_];
+        }
+
+        for (last_run_ = 0; last_run_ < num_runs_ && !fits(runs_[last_run_]); ++last_run_);
+        if (last_run_ == num_runs_) {
+            ASSERT(num_runs_ < runs_.size(), "ME FIFOSequencer: Too many pending runs");
+            runs_[num_runs_++] = {source, NONE, NONE};
+        }
+        return runs_[last_run_];
+    }
+
+    auto runHead(uint32_t run) const noexcept {
+        const auto &head = pending_client_requests_[runs_[run].head_];
+        return RunHead{head.request_.recv_time_, head.arrival_, run};
+    }
+
+    /// Starts a new journal segment from the oldest shard checkpoint - recovery replays every shard from its checkpoint on,
+    /// the records before that are never read again. Tried once the journal is half full, leaving the other half for the
+    /// requests sequenced until the checkpoints catch up.
+    void rotateJournal() noexcept {
+        auto checkpointed_seq_num = std::numeric_limits<size_t>::max();
+        for (auto shard : shards_) {
+            checkpointed_seq_num = std::min(checkpointed_seq_num, shard->checkpointed_seq_num_.load(std::memory_order_acquire));
+        }
+        if (checkpointed_seq_num <= journal_->firstIndex() + 1) {     // no checkpoint since the segment was started.
+            return;
+        }
+
+        logger_->log("%:% %() % Starting journal segment at seq:%, % requests in the old one.\n", __FILE__, __LINE__, __FUNCTION__,
+                     Common::getCurrentTimestamp(), checkpointed_seq_num, journal_->size());
+        journal_->startSegment(checkpointed_seq_num - 1);
+    }
 
 public:
-    FIFOSequencer(ClientRequestLFQueue* incoming_requests, Logger* logger) : incoming_requests_(incoming_requests), logger_(logger) {}
+    /// Requests are held until they are fairness_window old, 0 sequences everything at the next sequenceAndPublish().
+    FIFOSequencer(const MEShardChannelsList& shards, MEClientRequestJournalWriter* journal, size_t next_seq_num, Nanos fairness_window,
+                  Logger* logger)
+        : shards_(shards), journal_(journal), next_seq_num_(next_seq_num), fairness_window_(fairness_window), logger_(logger) {
+        for (uint32_t i = 0; i < pending_client_requests_.size(); ++i) {
+            pending_client_requests_[i].next_ = (i + 1 < pending_client_requests_.size() ? i + 1 : NONE);
+        }
+    }
     ~FIFOSequencer() {
         logger_ = nullptr;
-        incoming_requests_ = nullptr;
+        journal_ = nullptr;
+        shards_.clear();
     }
 
-    void addClientRequest(Nanos rx_time, const MEClientRequest &request) {
-        ASSERT(pending_size_ < pending_client_requests_.size(), "ME FIFOSequencer: Too many pending requests");
-        pending_client_requests_[pending_size_++] = std::move(RecvTimeClientRequest{rx_time, request});
+    /// Requests that can be added before the pending pool is full.
+    auto pendingRoom() const noexcept {
+        return pending_client_requests_.size() - pending_size_;
     }
 
-    void sequenceAndPublish() {
-        if (pending_size_ == 0) [[unlikely]] {
-            return;
-        }
+    /// Requests that can still be added before the journal is full. The OrderServer rejects the ones it has no room for,
+    /// until a new journal segment frees some.
+    auto journalRoom() const noexcept {
+        return journal_->capacity() - journal_->size() - pending_size_ - (num_ordered_ - next_ordered_);
+    }
+
+    /// Requests of the same source must be added in the order they were received.
+    void addClientRequest(int source, Nanos rx_time, const MEClientRequest &request) {
+        ASSERT(pending_size_ < pending_client_requests_.size(), "ME FIFOSequencer: Too many pending requests");
+        auto &run = runFor(source, rx_time);
 
-        logger_->log("%:% %() % Processing % requests.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), pending_size_);
+        const auto index = free_head_;
+        auto &pending = pending_client_requests_[index];
+        free_head_ = pending.next_;
+        pending = {{rx_time, request}, next_arrival_++, NONE};
+        ++pending_size_;
 
-        std::sort(pending_client_requests_.begin(), pending_client_requests_.begin() + pending_size_);
+        if (run.tail_ == NONE) {
+            run.head_ = index;
+        }
+        else {
+            pending_client_requests_[run.tail_].next_ = index;
+        }
+        run.tail_ = index;
+    }
 
-        for (size_t i = 0; i < pending_size_; ++i) {
-            const auto &client_request = pending_client_requests_.at(i);
+    /// Queues a TIMER for every shard whose next order expiry is due at now. Sequenced and journaled like client requests, so
+    /// expiries happen at the same point of the request sequence live and on replay.
+    void addExpiryTimers(Nanos now) {
+        for (size_t shard = 0; shard < shards_.size(); ++shard) {
+            const auto next_expiry_time = shards_[shard]->next_expiry_time_.load(std::memory_order_acquire);
+            if (next_expiry_time <= now && next_expiry_time != timer_expiry_times_[shard] && journalRoom() && pendingRoom()) [[unlikely]] {
+                timer_expiry_times_[shard] = next_expiry_time;
+                // Routed by ticker, and ticker shard is owned by shard.
+                addClientRequest(TIMER_SOURCE, now, {ClientRequestType::TIMER, ClientId_INVALID, static_cast<TickerId>(shard), OrderId_INVALID,
+                                       Side::INVALID, Price_INVALID, Qty_INVALID, 0});
+            }
+        }
+    }
 
-            logger_->log("%:% %() % Writing RX:% Req:% to FIFO.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
-                        client_request.recv_time_, client_request.me_client_request_.toString());
-                        
-            incoming_requests_->push(std::move(client_request.me_client_request_));
+    /// Sequences every pending request older than the fairness window, in receive time order, and publishes them. With
+    /// flush every pending request is, to make room for more. Never waits for a full shard ring - what does not fit is
+    /// published first by the next call, so the caller keeps draining the shards' responses in between.
+    void sequenceAndPublish(bool flush = false) {
+        // Also while nothing is pending, a full journal rejects every request until it is started over.
+        if (journal_->size() >= journal_->capacity() / 2) [[unlikely]] {
+            rotateJournal();
         }
 
-        pending_size_ = 0;
+        if (next_ordered_ == num_ordered_ && pending_size_) {
+            order(flush);
+        }
+        if (next_ordered_ < num_ordered_) {
+            publish();
+        }
     }
 
     FIFOSequencer() = delete;
@@ -65,5 +205,92 @@ public:
     FIFOSequencer(const FIFOSequencer&&) = delete;
     FIFOSequencer& operator=(const FIFOSequencer&) = delete;
     FIFOSequencer& operator=(const FIFOSequencer&&) = delete;
+
+private:
+    /// Moves the pending requests older than the fairness window (all of them with flush) into ordered_client_requests_.
+    void order(bool flush) noexcept {
+        const auto cutoff = (fairness_window_ && !flush) ? getCurrentNanos() - fairness_window_ : std::numeric_limits<Nanos>::max();
+
+        size_t num_heads = 0;
+        for (uint32_t run = 0; run < num_runs_; ++run) {
+            run_heads_[num_heads++] = runHead(run);
+        }
+        std::make_heap(run_heads_.begin(), run_heads_.begin() + num_heads, std::greater<>());
+
+        size_t num_ordered = 0;
+        while (num_heads && run_heads_.front().recv_time_ <= cutoff) {
+            std::pop_heap(run_heads_.begin(), run_heads_.begin() + num_heads, std::greater<>());
+            auto &run = runs_[run_heads_[num_heads - 1].run_];
+
+            const auto index = run.head_;
+            auto &pending = pending_client_requests_[index];
+            ordered_client_requests_[num_ordered++] = pending.request_;
+            run.head_ = pending.next_;
+            pending.next_ = free_head_;
+            free_head_ = index;
+
+            if (run.head_ != NONE) {
+                run_heads_[num_heads - 1] = runHead(run_heads_[num_heads - 1].run_);
+                std::push_heap(run_heads_.begin(), run_heads_.begin() + num_heads, std::greater<>());
+            }
+            else {
+                run.tail_ = NONE;
+                --num_heads;
+            }
+        }
+        pending_size_ -= num_ordered;
+        num_ordered_ = num_ordered;
+        next_ordered_ = 0;
+
+        // Drops the runs emptied above.
+        size_t num_runs = 0;
+        for (size_t run = 0; run < num_runs_; ++run) {
+            if (runs_[run].head_ != NONE) {
+                runs_[num_runs++] = runs_[run];
+            }
+        }
+        num_runs_ = num_runs;
+        last_run_ = num_runs_;
+
+        if (num_ordered) {
+            logger_->log("%:% %() % Processing % requests, % held.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                         num_ordered, pending_size_);
+        }
+    }
+
+    /// Stamps ordered_client_requests_ with the next global sequence numbers, journals them, and copies them straight into
+    /// the ring of the shard owning the ticker - runs of requests for the same shard are published with one store. Stops at
+    /// the first request whose shard ring is full.
+    void publish() noexcept {
+        while (next_ordered_ < num_ordered_) {
+            const auto shard = shardOf(ordered_client_requests_[next_ordered_].me_client_request_.ticker_id_, shards_.size());
+            auto &incoming_requests = shards_[shard]->client_requests_;
+            const auto slots = incoming_requests.tryClaimWrite(num_ordered_ - next_ordered_);
+            if (slots.empty()) [[unlikely]] {
+                logger_->log("%:% %() % Shard:% full, % requests left to publish.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                             shard, num_ordered_ - next_ordered_);
+                break;
+            }
+
+            size_t count = 0;
+            for (; count < slots.size() && next_ordered_ < num_ordered_ &&
+                   shardOf(ordered_client_requests_[next_ordered_].me_client_request_.ticker_id_, shards_.size()) == shard; ++count) {
+                const auto &client_request = ordered_client_requests_[next_ordered_++];
+
+                logger_->log("%:% %() % Writing seq:% RX:% Req:% to shard:%.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                            next_seq_num_, client_request.recv_time_, client_request.me_client_request_.toString(), shard);
+
+                const MESequencedClientRequest sequenced_request{next_seq_num_++, client_request.recv_time_, client_request.me_client_request_};
+                journal_->append(sequenced_request);
+                new(&slots[count]) MESequencedClientRequest(sequenced_request);
+            }
+            incoming_requests.commitWrite(count);
+        }
+
+        // After the requests, so a shard that has drained its queue knows it has seen everything routed below this.
+        for (auto shard : shards_) {
+            shard->routed_seq_num_.store(next_seq_num_, std::memory_order_release);
+        }
+    }
 };
 }
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+
+#include "common/journal.hpp"
+#include "common/logger.hpp"
+#include "common/macros.hpp"
+#include "common/time_utils.hpp"
+
+#include "order_server/client_request.hpp"
+#include "matching_engine/me_shard.hpp"
+
+namespace Exchange {
+    constexpr size_t ME_JOURNAL_MAX_RECORDS = 16 * 1024 * 1024;
+    constexpr Nanos ME_JOURNAL_SYNC_INTERVAL = 1 * NANOS_TO_MILLIS;
+
+    /// Routed watermarks are published at least this often while replaying, so the output merges keep moving.
+    constexpr size_t ME_REPLAY_WATERMARK_INTERVAL = 1024;
+
+    typedef JournalWriter<MESequencedClientRequest> MEClientRequestJournalWriter;
+    typedef JournalReader<MESequencedClientRequest> MEClientRequestJournalReader;
+
+    /// Feeds journaled requests back into the matching engine shards exactly as the FIFOSequencer published them - same
+    /// sequence numbers, same routing, same order - as fast as the shards consume them.
+    class JournalReplayer {
+    private:
+        MEShardChannelsList shards_;
+
+        Logger* logger_ = nullptr;
+
+        void publishRouted(size_t next_seq_num) noexcept {
+            for (auto shard : shards_) {
+                shard->routed_seq_num_.store(next_seq_num, std::memory_order_release);
+            }
+        }
+
+    public:
+        JournalReplayer(const MEShardChannelsList& shards, Logger* logger) : shards_(shards), logger_(logger) {}
+        ~JournalReplayer() {
+            logger_ = nullptr;
+            shards_.clear();
+        }
+
+        /// Returns the sequence number following the last replayed request. A shard restored from a checkpoint has already
+        /// published done_seq_num_ up to the checkpoint, and is only fed the requests from there on. journal_seq_num is the
+        /// sequence number of requests.front(), 1 unless the journal was started over in a new segment.
+        size_t replay(std::span<const MESequencedClientRequest> requests, size_t journal_seq_num) noexcept {
+            std::array<size_t, ME_MAX_SHARDS> start_seq_nums;
+            auto first_seq_num = std::numeric_limits<size_t>::max();
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                start_seq_nums[i] = std::max<size_t>(shards_[i]->done_seq_num_.load(std::memory_order_acquire), 1);
+                first_seq_num = std::min(first_seq_num, start_seq_nums[i]);
+            }
+            ASSERT(first_seq_num >= journal_seq_num, "Checkpoint at seq:" + std::to_string(first_seq_num) + " is behind the journal segment starting at seq:" +
+                   std::to_string(journal_seq_num));
+            ASSERT(first_seq_num <= journal_seq_num + requests.size(), "Checkpoint at seq:" + std::to_string(first_seq_num) + " is ahead of the journal with " +
+                   std::to_string(requests.size()) + " requests from seq:" + std::to_string(journal_seq_num));
+
+            size_t next_seq_num = first_seq_num, replayed = 0;
+            for (const auto &request : requests.subspan(first_seq_num - journal_seq_num)) {
+                ASSERT(request.seq_num_ == next_seq_num, "Journal out of sequence, expected:" + std::to_string(next_seq_num) + " found:" +
+                       request.toString());
+
+                const auto shard = shardOf(request.me_client_request_.ticker_id_, shards_.size());
+                if (request.seq_num_ >= start_seq_nums[shard]) {
+                    auto &incoming_requests = shards_[shard]->client_requests_;
+                    while (!incoming_requests.push(request));   // the shard is behind, wait for it.
+                    ++replayed;
+                }
+
+                if (++next_seq_num % ME_REPLAY_WATERMARK_INTERVAL == 0) {
+                    publishRouted(next_seq_num);
+                }
+            }
+            publishRouted(next_seq_num);
+
+            logger_->log("%:% %() % Replayed % of % journaled requests from seq:%.\n", __FILE__, __LINE__, __FUNCTION__,
+                         Common::getCurrentTimestamp(), replayed, requests.size(), first_seq_num);
+
+            return next_seq_num;
+        }
+
+        /// True once every shard has published all outputs of the requests below seq_num.
+        bool done(size_t seq_num) const noexcept {
+            for (auto shard : shards_) {
+                if (shard->done_seq_num_.load(std::memory_order_acquire) < seq_num) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        JournalReplayer() = delete;
+        JournalReplayer(const JournalReplayer&) = delete;
+        JournalReplayer(const JournalReplayer&&) = delete;
+        JournalReplayer& operator=(const JournalReplayer&) = delete;
+        JournalReplayer& operator=(const JournalReplayer&&) = delete;
+    };
+}
@@ -1,15 +1,25 @@
 #include "order_server/order_server.hpp"
 
 namespace Exchange {
-    OrderServer::OrderServer(const std::string& iface, int port, ClientResponseLFQueue* outgoing_responses, ClientRequestLFQueue* incoming_requests)
-        : iface_(iface), port_(port), outgoing_responses_(outgoing_responses), logger_("exchange_order_server.log"), 
-        tcp_server_(logger_), fifo_sequencer_(incoming_requests, &logger_) {
+    OrderServer::OrderServer(const std::string& iface, int port, const MEShardChannelsList& shards, const InstrumentConfigs& instrument_configs,
+        MEClientRequestJournalWriter* journal, size_t first_live_seq_num, bool cancel_on_disconnect, Nanos fairness_window) : iface_(iface), port_(port), shards_(shards), first_live_seq_num_(first_live_seq_num),
+        cancel_on_disconnect_(cancel_on_disconnect), logger_("exchange_order_server.log"), tcp_server_(logger_), fifo_sequencer_(shards, journal, first_live_seq_num, fairness_window, &logger_) {
         cid_next_outgoing_seq_num_.fill(1);
         cid_next_exp_seq_num_.fill(1);
         cid_tcp_socket_.fill(nullptr);
 
+        for (size_t shard = 0; shard < shards_.size(); ++shard) {
+            for (TickerId ticker_id = shard; ticker_id < instrument_configs.size(); ticker_id += shards_.size()) {
+                if (instrument_configs[ticker_id]) {
+                    ticker_shards_.push_back(shard);
+                    break;
+                }
+            }
+        }
+
         tcp_server_.recv_callback_ = [this](auto socket, auto rx_time) { recvCallback(socket, rx_time); };
         tcp_server_.recv_finished_callback_ = [this]() { recvFinishedCallback(); };
+        tcp_server_.disconnect_callback_ = [this](auto socket) { disconnectCallback(socket); };
     }
 
     OrderServer::~OrderServer() {
@@ -31,69 +41,209 @@ namespace Exchange {
     }
 
     void OrderServer::run() noexcept {
-        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
         while (running_) {
             tcp_server_.poll();
             tcp_server_.sendAndRecv();
 
-            while (outgoing_responses_->pop(me_client_response_)) {
-                auto &next_outgoing_seq_num = cid_next_outgoing_seq_num_[me_client_response_.client_id_];
-                logger_.log("%:% %() % Processing cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
-                            me_client_response_.client_id_, next_outgoing_seq_num, me_client_response_.toString());
+            fifo_sequencer_.addExpiryTimers(getCurrentNanos());
+            fifo_sequencer_.sequenceAndPublish();
+
+            // Responses of all shards, merged back into the order the requests were sequenced in.
+            mergeShardOutputs(shards_,
+                [this](size_t shard) { return shards_[shard]->client_responses_.peekRead(shards_[shard]->client_responses_.capacity()); },
+                [this](size_t shard, size_t count) { shards_[shard]->client_responses_.releaseRead(count); },
+                [this](const MESequencedClientResponse& client_response) {
+                    if (client_response.seq_num_ >= first_live_seq_num_) [[likely]] {
+                        sendClientResponse(client_response.me_client_response_);
+                    }
+                });
+        }
+    }
+
+    void OrderServer::sendClientResponse(const MEClientResponse& me_client_response) noexcept {
+        auto &next_outgoing_seq_num = cid_next_outgoing_seq_num_[me_client_response.client_id_];
+        logger_.log("%:% %() % Processing cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
+                    me_client_response.client_id_, next_outgoing_seq_num, me_client_response.toString());
+
+        if (cid_tcp_socket_[me_client_response.client_id_] == nullptr) [[unlikely]] {   // client disconnected since.
+            logger_.log("%:% %() % Dropping response, no TCPSocket for ClientId:%\n", __FILE__, __LINE__, __FUNCTION__,
+                        Common::getCurrentTimestamp(), me_client_response.client_id_);
+            return;
+        }
+        cid_tcp_socket_[me_client_response.client_id_]->send(&next_outgoing_seq_num, sizeof(next_outgoing_seq_num));
+        cid_tcp_socket_[me_client_response.client_id_]->send(&me_client_response, sizeof(MEClientResponse));
+
+        ++next_outgoing_seq_num;
+    }
+
+    void OrderServer::checkClientSequence(TCPSocket* socket, ClientId client_id, size_t seq_num) noexcept {
+        if (cid_tcp_socket_[client_id] == nullptr) [[unlikely]] { // first message from this ClientId.
+            cid_tcp_socket_[client_id] = socket;
+        }
+
+        if (cid_tcp_socket_[client_id] != socket) [[unlikely]] {   // mismatch socket
+            logger_.log("%:% %() % Received ClientRequest from ClientId:% on different socket:% expected:%\n", __FILE__, __LINE__, __FUNCTION__,
+                        Common::getCurrentTimestamp(), client_id, socket->socket_fd_, cid_tcp_socket_[client_id]->socket_fd_);
+            MEClientResponse response {ClientResponseType::REJECTED, client_id, TickerId_INVALID, 
+                            OrderId_INVALID, OrderId_INVALID, Side::INVALID, Price_INVALID, Qty_INVALID, Qty_INVALID};
+            sendClientResponse(response);
+        }
 
-                ASSERT(cid_tcp_socket_[me_client_response_.client_id_] != nullptr,
-                        "Dont have a TCPSocket for ClientId:" + std::to_string(me_client_response_.client_id_));
-                cid_tcp_socket_[me_client_response_.client_id_]->send(&next_outgoing_seq_num, sizeof(next_outgoing_seq_num));
-                cid_tcp_socket_[me_client_response_.client_id_]->send(&me_client_response_, sizeof(MEClientResponse));
+        auto& next_exp_seq_num = cid_next_exp_seq_num_[client_id];
+        if (seq_num != next_exp_seq_num) [[unlikely]] {                               // out of order sequence number
+            logger_.log("%:% %() % Incorrect sequence number. ClientId:% SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                        Common::getCurrentTimestamp(), client_id, next_exp_seq_num, seq_num);
+            MEClientResponse response {ClientResponseType::REJECTED, client_id, TickerId_INVALID, 
+                            OrderId_INVALID, OrderId_INVALID, Side::INVALID, Price_INVALID, Qty_INVALID, Qty_INVALID};
+            sendClientResponse(response);
+        }
 
-                ++next_outgoing_seq_num;
+        ++next_exp_seq_num;
+    }
+
+    void OrderServer::queueClientRequest(int source, Nanos rx_time, const MEClientRequest& request) noexcept {
+        const bool every_ticker = (request.type_ == ClientRequestType::CANCEL_ALL && request.ticker_id_ == TickerId_INVALID);
+        const size_t num_requests = (every_ticker ? ticker_shards_.size() : 1);
+        if (fifo_sequencer_.journalRoom() < num_requests) [[unlikely]] {
+            logger_.log("%:% %() % Journal full, rejecting %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), request.toString());
+            rejectClientRequest(request);
+            return;
+        }
+
+        // Sequenced ahead of the fairness window rather than overflowing the pool - only under a flood of requests.
+        if (fifo_sequencer_.pendingRoom() < num_requests) [[unlikely]] {
+            logger_.log("%:% %() % Pending requests full, flushing.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
+            fifo_sequencer_.sequenceAndPublish(true);
+        }
+        if (fifo_sequencer_.pendingRoom() < num_requests) [[unlikely]] {   // the shards are not keeping up either.
+            logger_.log("%:% %() % Pending requests full, rejecting %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), request.toString());
+            rejectClientRequest(request);
+            return;
+        }
+
+        if (every_ticker) {
+            auto shard_request = request;
+            shard_request.type_ = ClientRequestType::CANCEL_ALL_SHARD;
+            for (const auto shard : ticker_shards_) {
+                // Routed by ticker, and ticker shard is owned by shard.
+                shard_request.ticker_id_ = static_cast<TickerId>(shard);
+                fifo_sequencer_.addClientRequest(source, rx_time, shard_request);
             }
+            return;
+        }
+
+        fifo_sequencer_.addClientRequest(source, rx_time, request);
+    }
+
+    void OrderServer::rejectClientRequest(const MEClientRequest& request) noexcept {
+        auto type = ClientResponseType::REJECTED;
+        switch (request.type_) {
+            case ClientRequestType::CANCEL:
+            case ClientRequestType::CANCEL_ALL:
+                type = ClientResponseType::CANCEL_REJECTED;
+            break;
+            case ClientRequestType::MODIFY:
+                type = ClientResponseType::MODIFY_REJECTED;
+            break;
+            default:
+            break;
         }
+
+        sendClientResponse({type, request.client_id_, request.ticker_id_, request.client_order_id_, OrderId_INVALID, request.side_,
+                            request.price_, Qty_INVALID, request.qty_});
     }
 
     void OrderServer::recvCallback(TCPSocket* socket, Nanos rx_time) noexcept {
-        logger_.log("%:% %() % Received socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+        logger_.log("%:% %() % Received socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
                   socket->socket_fd_, socket->next_rcv_valid_index_, rx_time);
 
-        if (socket->next_rcv_valid_index_ >= sizeof(PubClientRequest)) {
-            size_t i = 0;
-            for (; i + sizeof(PubClientRequest) <= socket->next_rcv_valid_index_; i += sizeof(PubClientRequest)) {
-                auto request = reinterpret_cast<const PubClientRequest *>(socket->inbound_data_.data() + i);
-                
-                logger_.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), request->toString());
+        // Messages are PubClientRequests or PubClientBulkRequests, told apart by the request type they share the offset of.
+        size_t i = 0;
+        while (i + PubClientBulkRequest::headerSize() <= socket->next_rcv_valid_index_) {
+            const auto data = socket->inbound_data_.data() + i;
+            const auto available = socket->next_rcv_valid_index_ - i;
 
-                if (cid_tcp_socket_[request->me_client_request_.client_id_] == nullptr) [[unlikely]] { // first message from this ClientId.
-                    cid_tcp_socket_[request->me_client_request_.client_id_] = socket;
+            if (reinterpret_cast<const PubClientBulkRequest *>(data)->type_ == ClientRequestType::BULK) {
+                auto bulk = reinterpret_cast<const PubClientBulkRequest *>(data);
+                if (bulk->size() > available) {
+                    break;
                 }
+                i += bulk->size();
 
-                if (cid_tcp_socket_[request->me_client_request_.client_id_] != socket) [[unlikely]] {   // mismatch socket
-                    logger_.log("%:% %() % Received ClientRequest from ClientId:% on different socket:% expected:%\n", __FILE__, __LINE__, __FUNCTION__,
-                                Common::getCurrentTimeStr(&time_str_), request->me_client_request_.client_id_, socket->socket_fd_,
-                                cid_tcp_socket_[request->me_client_request_.client_id_]->socket_fd_);
-                    MEClientResponse response {ClientResponseType::REJECTED, request->me_client_request_.client_id_, TickerId_INVALID, 
-                                    OrderId_INVALID, OrderId_INVALID, Side::INVALID, Price_INVALID, Qty_INVALID, Qty_INVALID};
-                    outgoing_responses_->push(response);
+                logger_.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), bulk->toString());
+                if (bulk->client_id_ >= ME_MAX_NUM_CLIENTS) [[unlikely]] {     // no client to answer, every per client table is indexed by it.
+                    logger_.log("%:% %() % Dropping message with invalid ClientId:%\n", __FILE__, __LINE__, __FUNCTION__,
+                                Common::getCurrentTimestamp(), bulk->client_id_);
+                    continue;
                 }
+                checkClientSequence(socket, bulk->client_id_, bulk->seq_num_);
 
-                auto& next_exp_seq_num = cid_next_exp_seq_num_[request->me_client_request_.client_id_];
-                if (request->seq_num_ != next_exp_seq_num) [[unlikely]] {                               // out of order sequence number
-                    logger_.log("%:% %() % Incorrect sequence number. ClientId:% SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
-                                Common::getCurrentTimeStr(&time_str_), request->me_client_request_.client_id_, next_exp_seq_num, request->seq_num_);
-                    MEClientResponse response {ClientResponseType::REJECTED, request->me_client_request_.client_id_, TickerId_INVALID, 
+                if (bulk->num_requests_ > ME_MAX_BULK_REQUESTS) [[unlikely]] {
+                    MEClientResponse response {ClientResponseType::REJECTED, bulk->client_id_, TickerId_INVALID, 
                                     OrderId_INVALID, OrderId_INVALID, Side::INVALID, Price_INVALID, Qty_INVALID, Qty_INVALID};
-                    outgoing_responses_->push(response);
+                    sendClientResponse(response);
+                    continue;
                 }
 
-                ++next_exp_seq_num;
+                for (size_t j = 0; j < bulk->num_requests_; ++j) {
+                    auto request = bulk->requests_[j];
+                    request.client_id_ = bulk->client_id_;
+                    if (!isClientRequestType(request.type_, true)) [[unlikely]] {
+                        rejectClientRequest(request);
+                        continue;
+                    }
+                    queueClientRequest(socket->socket_fd_, rx_time, request);
+                }
+            }
+            else {
+                if (sizeof(PubClientRequest) > available) {
+                    break;
+                }
+                i += sizeof(PubClientRequest);
+
+                auto request = reinterpret_cast<const PubClientRequest *>(data);
+                logger_.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), request->toString());
+                if (request->me_client_request_.client_id_ >= ME_MAX_NUM_CLIENTS) [[unlikely]] {
+                    logger_.log("%:% %() % Dropping message with invalid ClientId:%\n", __FILE__, __LINE__, __FUNCTION__,
+                                Common::getCurrentTimestamp(), request->me_client_request_.client_id_);
+                    continue;
+                }
+                checkClientSequence(socket, request->me_client_request_.client_id_, request->seq_num_);
 
-                fifo_sequencer_.addClientRequest(rx_time, request->me_client_request_);
+                if (!isClientRequestType(request->me_client_request_.type_, false)) [[unlikely]] {
+                    rejectClientRequest(request->me_client_request_);
+                    continue;
+                }
+                queueClientRequest(socket->socket_fd_, rx_time, request->me_client_request_);
             }
-            memcpy(socket->inbound_data_.data(), socket->inbound_data_.data() + i, socket->next_rcv_valid_index_ - i);
-            socket->next_rcv_valid_index_ -= i;
         }
+        memcpy(socket->inbound_data_.data(), socket->inbound_data_.data() + i, socket->next_rcv_valid_index_ - i);
+        socket->next_rcv_valid_index_ -= i;
     }
 
     void OrderServer::recvFinishedCallback() noexcept {
         fifo_sequencer_.sequenceAndPublish();
     }
+
+    void OrderServer::disconnectCallback(TCPSocket* socket) noexcept {
+        for (ClientId client_id = 0; client_id < ME_MAX_NUM_CLIENTS; ++client_id) {
+            if (cid_tcp_socket_[client_id] != socket) {
+                continue;
+            }
+
+            logger_.log("%:% %() % ClientId:% disconnected socket:% cancel_on_disconnect:%\n", __FILE__, __LINE__, __FUNCTION__,
+                        Common::getCurrentTimestamp(), client_id, socket->socket_fd_, cancel_on_disconnect_);
+            if (cancel_on_disconnect_) {
+                queueClientRequest(socket->socket_fd_, getCurrentNanos(), {ClientRequestType::CANCEL_ALL, client_id, TickerId_INVALID, OrderId_INVALID,
+                                                       Side::INVALID, Price_INVALID, Qty_INVALID});
+            }
+
+            cid_tcp_socket_[client_id] = nullptr;
+            cid_next_exp_seq_num_[client_id] = 1;
+            cid_next_outgoing_seq_num_[client_id] = 1;
+        }
+
+        fifo_sequencer_.sequenceAndPublish();
+    }
 }
\ No newline at end of file
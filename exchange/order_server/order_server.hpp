@@ -1,5 +1,6 @@
 #pragma once
 
+#include "common/instruments.hpp"
 #include "common/tcp_server.hpp"
 #include "common/thread_utils.hpp"
 #include "common/types.hpp"
@@ -15,11 +16,19 @@ private:
     const std::string iface_;
     const int port_ = 0;
 
-    ClientResponseLFQueue* outgoing_responses_ = nullptr;
+    MEShardChannelsList shards_;
+
+    // Shards owning a configured ticker, the only ones a CANCEL_ALL for every ticker needs to reach.
+    std::vector<size_t> ticker_shards_;
+
+    // Responses to requests below this were produced while recovering from the journal, nobody is waiting for them.
+    const size_t first_live_seq_num_ = 1;
+
+    // Pull every resting order of a client when its connection goes away.
+    const bool cancel_on_disconnect_ = false;
 
     volatile bool running_ = false;
 
-    std::string time_str_;
     Logger logger_;
 
     Common::TCPServer tcp_server_;
@@ -29,10 +38,27 @@ private:
     std::array<size_t, ME_MAX_NUM_CLIENTS> cid_next_exp_seq_num_;
     std::array<Common::TCPSocket*, ME_MAX_NUM_CLIENTS> cid_tcp_socket_;
 
-    MEClientResponse me_client_response_;
+    /// Binds client_id to socket on its first message, and rejects messages arriving on another socket or out of sequence.
+    void checkClientSequence(TCPSocket* socket, ClientId client_id, size_t seq_num) noexcept;
+
+    /// Hands a request to the FIFOSequencer. A CANCEL_ALL for every ticker becomes one CANCEL_ALL_SHARD per shard, so every
+    /// sequenced request still belongs to exactly one matching engine shard. source is the connection it came in on. Requests
+    /// the journal has no room left for are rejected instead, and a full pending pool is flushed to the shards first - they
+    /// are rejected too if that frees nothing because the shards are not keeping up.
+    void queueClientRequest(int source, Nanos rx_time, const MEClientRequest& request) noexcept;
+
+    /// Only NEW / CANCEL / MODIFY can be bulked, and CANCEL_ALL sent on its own - the other types are never sent by clients.
+    static bool isClientRequestType(ClientRequestType type, bool bulked) noexcept {
+        return type == ClientRequestType::NEW || type == ClientRequestType::CANCEL || type == ClientRequestType::MODIFY ||
+               (type == ClientRequestType::CANCEL_ALL && !bulked);
+    }
+
+    /// Answers a request that will never be sequenced with the rejection of its type.
+    void rejectClientRequest(const MEClientRequest& request) noexcept;
 
 public:
-    OrderServer(const std::string& iface, int port, ClientResponseLFQueue* outgoing_responses, ClientRequestLFQueue* incoming_requests);
+    OrderServer(const std::string& iface, int port, const MEShardChannelsList& shards, const InstrumentConfigs& instrument_configs,
+                MEClientRequestJournalWriter* journal, size_t first_live_seq_num, bool cancel_on_disconnect, Nanos fairness_window);
     ~OrderServer();
 
     void start();
@@ -40,9 +66,15 @@ public:
 
     void run() noexcept;
 
+    /// Decodes every complete PubClientRequest / PubClientBulkRequest received on socket and queues them for sequencing.
     void recvCallback(TCPSocket* socket, Nanos rx_time) noexcept;
     void recvFinishedCallback() noexcept;
 
+    /// Unbinds the clients of a socket the peer hung up, so they can log on again, cancelling their orders if configured to.
+    void disconnectCallback(TCPSocket* socket) noexcept;
+
+    void sendClientResponse(const MEClientResponse& me_client_response) noexcept;
+
     OrderServer() = delete;
     OrderServer(const OrderServer&) = delete;
     OrderServer(const OrderServer&&) = delete;
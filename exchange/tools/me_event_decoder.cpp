@@ -0,0 +1,40 @@
+#include <fstream>
+
+#include "matching_engine/me_event_tap.hpp"
+
+// Formats an event tap file written by a MatchingEngine's MEEventTap to stdout, one event per line.
+int main(int argc, char **argv) {
+    using namespace Exchange;
+
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <event tap file>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file(argv[1], std::ios::in | std::ios::binary);
+    ASSERT(file.is_open(), "Failed to open event tap: " + std::string(argv[1]));
+
+    METapHeader header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    ASSERT(file && header.magic_ == ME_EVENT_TAP_MAGIC, std::string(argv[1]) + " is not an event tap file");
+    ASSERT(header.version_ == ME_EVENT_TAP_VERSION && header.event_size_ == sizeof(MEEvent),
+           "Unsupported event tap version:" + std::to_string(header.version_) + " event size:" + std::to_string(header.event_size_));
+
+    TSCCalibration calibration;
+    MEEvent event;
+    size_t num_events = 0;
+    while (file.read(reinterpret_cast<char *>(&event), sizeof(event))) {
+        if (event.type_ == MEEventType::CALIBRATION) {
+            calibration = event.calibration_;
+            continue;
+        }
+        std::cout << event.toString(calibration) << "\n";
+        ++num_events;
+    }
+    if (file.gcount() != 0) {
+        std::cerr << "Truncated event at end of " << argv[1] << std::endl;
+    }
+
+    std::cerr << num_events << " events" << std::endl;
+    return 0;
+}
@@ -35,7 +35,7 @@ namespace Trading {
     }
 
     void MarketDataConsumer::run() noexcept {
-        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
         while(running_) {
             incremental_updates_socket_.sendAndRecv();
             snapshot_updates_socket_.sendAndRecv();
@@ -48,7 +48,7 @@ namespace Trading {
         if (is_snapshot && !in_recovery_) [[unlikely]] {
             socket->next_rcv_valid_index_ = 0;
             logger_.log("%:% %() % WARN Not expecting snapshot messages.\n",
-                        __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+                        __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
             return;
         }
 
@@ -56,7 +56,7 @@ namespace Trading {
             size_t i = 0;
             for (; i + sizeof(Exchange::PubMarketUpdate) <= socket->next_rcv_valid_index_; i += sizeof(Exchange::PubMarketUpdate)) {
                 auto request = reinterpret_cast<const Exchange::PubMarketUpdate*>(socket->inbound_data_.data() + i);
-                logger_.log("%:% %() % Received % socket len:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                logger_.log("%:% %() % Received % socket len:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
                     (is_snapshot ? "snapshot" : "incremental"), sizeof(Exchange::PubMarketUpdate), request->toString());
                 
                 const bool already_in_recovery = in_recovery_;
@@ -65,14 +65,14 @@ namespace Trading {
                 if (in_recovery_) [[unlikely]] {
                     if (!already_in_recovery) [[unlikely]] { // start of recovery
                         logger_.log("%:% %() % Packet drops on % socket. SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
-                            Common::getCurrentTimeStr(&time_str_), (is_snapshot ? "snapshot" : "incremental"), next_exp_inc_seq_num_, request->seq_num_);
+                            Common::getCurrentTimestamp(), (is_snapshot ? "snapshot" : "incremental"), next_exp_inc_seq_num_, request->seq_num_);
                         startSnapshotSync();
                     }
 
                     queueMessage(is_snapshot, request);
                 } 
                 else if (!is_snapshot) {
-                    logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), request->toString());
+                    logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), request->toString());
 
                     incoming_md_updates_->push(std::move(request->me_market_update_));
                     ++next_exp_inc_seq_num_;
@@ -101,7 +101,7 @@ namespace Trading {
         const auto &first_snapshot_msg = snapshot_queued_msgs_.begin()->second;
         if (first_snapshot_msg.type_ != Exchange::MarketUpdateType::SNAPSHOT_START) {
             logger_.log("%:% %() % Expected SNAPSHOT_START\n",
-                        __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+                        __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
             snapshot_queued_msgs_.clear();
             return;
         }
@@ -111,10 +111,10 @@ namespace Trading {
         size_t next_snapshot_seq = 0;
         for (auto &snapshot_itr: snapshot_queued_msgs_) {
             logger_.log("%:% %() % % => %\n", __FILE__, __LINE__, __FUNCTION__,
-                        Common::getCurrentTimeStr(&time_str_), snapshot_itr.first, snapshot_itr.second.toString());
+                        Common::getCurrentTimestamp(), snapshot_itr.first, snapshot_itr.second.toString());
             if (snapshot_itr.first != next_snapshot_seq) {
                 logger_.log("%:% %() % Detected gap in snapshot stream expected:% found:% %.\n", __FILE__, __LINE__, __FUNCTION__,
-                            Common::getCurrentTimeStr(&time_str_), next_snapshot_seq, snapshot_itr.first, snapshot_itr.second.toString());
+                            Common::getCurrentTimestamp(), next_snapshot_seq, snapshot_itr.first, snapshot_itr.second.toString());
                 snapshot_queued_msgs_.clear();
                 return;
             }
@@ -129,7 +129,7 @@ namespace Trading {
         const auto &last_snapshot_msg = snapshot_queued_msgs_.rbegin()->second;
             if (last_snapshot_msg.type_ != Exchange::MarketUpdateType::SNAPSHOT_END) {
             logger_.log("%:% %() % Expected SNAPSHOT_END\n",
-                        __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+                        __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
             return;
         }
 
@@ -137,19 +137,19 @@ namespace Trading {
         next_exp_inc_seq_num_ = last_snapshot_msg.order_id_ + 1;
         for (auto inc_itr = incremental_queued_msgs_.begin(); inc_itr != incremental_queued_msgs_.end(); ++inc_itr) {
             logger_.log("%:% %() % Checking next_exp:% vs. seq:% %.\n", __FILE__, __LINE__, __FUNCTION__,
-                        Common::getCurrentTimeStr(&time_str_), next_exp_inc_seq_num_, inc_itr->first, inc_itr->second.toString());
+                        Common::getCurrentTimestamp(), next_exp_inc_seq_num_, inc_itr->first, inc_itr->second.toString());
 
             if (inc_itr->first < next_exp_inc_seq_num_) continue;
 
             if (inc_itr->first != next_exp_inc_seq_num_) {
                 logger_.log("%:% %() % Detected gap in incremental stream expected:% found:% %.\n", __FILE__, __LINE__, __FUNCTION__,
-                            Common::getCurrentTimeStr(&time_str_), next_exp_inc_seq_num_, inc_itr->first, inc_itr->second.toString());
+                            Common::getCurrentTimestamp(), next_exp_inc_seq_num_, inc_itr->first, inc_itr->second.toString());
                 snapshot_queued_msgs_.clear();
                 return;;
             }
 
             logger_.log("%:% %() % % => %\n", __FILE__, __LINE__, __FUNCTION__,
-                        Common::getCurrentTimeStr(&time_str_), inc_itr->first, inc_itr->second.toString());
+                        Common::getCurrentTimestamp(), inc_itr->first, inc_itr->second.toString());
 
             if (inc_itr->second.type_ != Exchange::MarketUpdateType::SNAPSHOT_START &&
                 inc_itr->second.type_ != Exchange::MarketUpdateType::SNAPSHOT_END)
@@ -164,7 +164,7 @@ namespace Trading {
         }
 
         logger_.log("%:% %() % Recovered % snapshot and % incremental orders.\n", __FILE__, __LINE__, __FUNCTION__,
-                    Common::getCurrentTimeStr(&time_str_), snapshot_queued_msgs_.size() - 2, num_incrementals);
+                    Common::getCurrentTimestamp(), snapshot_queued_msgs_.size() - 2, num_incrementals);
 
         snapshot_queued_msgs_.clear();
         incremental_queued_msgs_.clear();
@@ -176,7 +176,7 @@ namespace Trading {
     void MarketDataConsumer::queueMessage(bool is_snapshot, const Exchange::PubMarketUpdate* request) {
         if (is_snapshot) {
             if (snapshot_queued_msgs_.contains(request->seq_num_)) {
-                logger_.log("%:% %() % Packet drops on snapshot socket. Received for a 2nd time:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), request->toString());
+                logger_.log("%:% %() % Packet drops on snapshot socket. Received for a 2nd time:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), request->toString());
                 snapshot_queued_msgs_.clear();
             }
             snapshot_queued_msgs_[request->seq_num_] = request->me_market_update_;
@@ -186,7 +186,7 @@ namespace Trading {
         }
 
         logger_.log("%:% %() % size snapshot:% incremental:% % => %\n", __FILE__, __LINE__, __FUNCTION__,
-                    Common::getCurrentTimeStr(&time_str_), snapshot_queued_msgs_.size(), incremental_queued_msgs_.size(), request->seq_num_, request->toString());
+                    Common::getCurrentTimestamp(), snapshot_queued_msgs_.size(), incremental_queued_msgs_.size(), request->seq_num_, request->toString());
 
         checkSnapshotSync();
     }
@@ -15,7 +15,6 @@ namespace Trading {
         volatile bool running_ = false;
         
         Logger logger_;
-        std::string time_str_;
         
         Common::MCastSocket incremental_updates_socket_;
         Common::MCastSocket snapshot_updates_socket_;
@@ -30,12 +30,12 @@ namespace Trading {
     }
 
     void OrderGateway::run() noexcept {
-        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp());
         while (running_) {
             tcp_socket_.sendAndRecv();
 
             while (outgoing_requests_->pop(me_client_request_)) {
-                logger_.log("%:% %() % Sending cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                logger_.log("%:% %() % Sending cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
                             me_client_request_.client_id_, next_outgoing_seq_num_, me_client_request_.toString());
 
                 tcp_socket_->send(&next_outgoing_seq_num_, sizeof(next_outgoing_seq_num_));
@@ -47,7 +47,7 @@ namespace Trading {
     }
 
     void OrderGateway::recvCallback(TCPSocket* socket, Nanos rx_time) noexcept {
-        logger_.log("%:% %() % Received socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+        logger_.log("%:% %() % Received socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(),
                   socket->socket_fd_, socket->next_rcv_valid_index_, rx_time);
 
         if (socket->next_rcv_valid_index_ >= sizeof(Exchange::PubClientResponse)) {
@@ -55,17 +55,17 @@ namespace Trading {
             for (; i + sizeof(Exchange::PubClientResponse) <= socket->next_rcv_valid_index_; i += sizeof(Exchange::PubClientResponse)) {
                 auto response = reinterpret_cast<const Exchange::PubClientResponse*>(socket->inbound_data_.data() + i);
                 
-                logger_.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), response->toString());
+                logger_.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimestamp(), response->toString());
 
                 if (response->me_client_response_.client_id_ != client_id_) [[unlikely]] {   // mismatch client_id
                     logger_.log("%:% %() % Received ClientResponse for different ClientId:% expected:%\n", __FILE__, __LINE__, __FUNCTION__,
-                                Common::getCurrentTimeStr(&time_str_), response->me_client_response_.client_id_, client_id_);
+                                Common::getCurrentTimestamp(), response->me_client_response_.client_id_, client_id_);
                     continue;
                 }
 
                 if (response->seq_num_ != next_exp_seq_num_) [[unlikely]] {                               // out of order sequence number
                     logger_.log("%:% %() % Incorrect sequence number. ClientId:% SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
-                                Common::getCurrentTimeStr(&time_str_), response->me_client_response_.client_id_, next_exp_seq_num, response->seq_num_);
+                                Common::getCurrentTimestamp(), response->me_client_response_.client_id_, next_exp_seq_num, response->seq_num_);
                     continue;
                 }
 
@@ -24,7 +24,6 @@ namespace Trading {
 
         volatile bool running_ = false;
 
-        std::string time_str_;
         Logger logger_;
 
         Common::TCPSocket tcp_socket_;
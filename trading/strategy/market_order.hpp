@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <sstream>
 
 #include "common/types.hpp"
@@ -40,35 +41,28 @@ namespace Trading {
 
     typedef std::array<MarketOrder*, ME_MAX_ORDER_IDS> OrderHashMap;
 
-    struct MarketOrdersAtPrice {
-        Side side_ = Side::INVALID;
-        Price price_ = Price_INVALID;
-
+    /// Entry of the book's PriceLadder, laid out like the exchange's MEOrdersAtPrice.
+    struct alignas(32) MarketOrdersAtPrice {
         MarketOrder* first_order_ = nullptr;
-
-        MarketOrdersAtPrice* prev_entry_ = nullptr;
-        MarketOrdersAtPrice* next_entry_ = nullptr;
+        Price price_ = Price_INVALID;
+        Side side_ = Side::INVALID;
 
         MarketOrdersAtPrice() = default;
 
-        MarketOrdersAtPrice(Side side, Price price, MarketOrder* first_order, MarketOrdersAtPrice* prev_entry, MarketOrdersAtPrice* next_entry)
-            : side_(side), price_(price), first_order_(first_order), prev_entry_(prev_entry), next_entry_(next_entry) {}
+        MarketOrdersAtPrice(Side side, Price price, MarketOrder* first_order)
+            : first_order_(first_order), price_(price), side_(side) {}
 
         std::string toString() const {
             std::stringstream ss;
             ss << "MarketOrdersAtPrice["
                 << "side:" << sideToString(side_) << " "
                 << "price:" << priceToString(price_) << " "
-                << "first_order:" << (first_order_ ? first_order_->toString() : "null") << " "
-                << "prev:" << priceToString(prev_entry_ ? prev_entry_->price_ : Price_INVALID) << " "
-                << "next:" << priceToString(next_entry_ ? next_entry_->price_ : Price_INVALID) << "]";
+                << "first_order:" << (first_order_ ? first_order_->toString() : "null") << "]";
 
             return ss.str();
         }
     };
 
-    typedef std::array<MarketOrdersAtPrice*, ME_MAX_PRICE_LEVELS> OrdersAtPriceHashMap;
-
     struct BBO {
         Price bid_price_ = Price_INVALID;
         Price ask_price_ = Price_INVALID;
@@ -1,18 +1,18 @@
 #pragma once
 
 #include "common/mem_pool.hpp"
+#include "common/price_ladder.hpp"
 #include "common/logger.hpp"
 #include "common/macros.hpp"
 #include "common/types.hpp"
 #include "strategy/market_order.hpp"
+#include "strategy/trading_engine.hpp"
 
-#include "exchange/market_data/market_update.h"
+#include "market_data/market_update.hpp"
 
 using namespace Common;
 
 namespace Trading {
-    class TradingEngine;
-
     class MarketOrderBook final {
     private:
         TickerId ticker_id_ = TickerId_INVALID;
@@ -21,19 +21,15 @@ namespace Trading {
 
         OrderHashMap oid_to_order_;
 
-        MemPool<MarketOrdersAtPrice> orders_at_price_pool_;
-        MarketOrdersAtPrice* bids_at_price_ = nullptr;
-        MarketOrdersAtPrice* asks_at_price_ = nullptr;
-
-        OrdersAtPriceHashMap price_orders_at_price_;
+        // Same ladder the exchange's MEOrderBook matches on, so both books share one implementation.
+        PriceLadder<MarketOrdersAtPrice> ladder_;
         MemPool<MarketOrder> order_pool_;
         BBO bbo_;
         
-        std::string time_str_;
         Logger* logger_ = nullptr;
 
     public:
-        explicit MarketOrderBook(TickerId ticker_id, TradingEngine* trading_engine_, Logger* logger);
+        explicit MarketOrderBook(TickerId ticker_id, const InstrumentConfig& instrument_config, TradingEngine* trading_engine, Logger* logger);
         ~MarketOrderBook();
 
         const BBO* getBBO() const {
@@ -45,8 +41,8 @@ namespace Trading {
         void updateBBO(bool update_bid, bool update_ask) noexcept;
         void onMarketUpdate(const Exchange::MEMarketUpdate *market_update) noexcept;
 
-        void setTradeEngine(TradeEngine* trade_engine) {
-            trading_engine_ = trade_engine;
+        void setTradingEngine(TradingEngine* trading_engine) {
+            trading_engine_ = trading_engine;
         }
 
         MarketOrderBook() = delete;
@@ -56,20 +52,9 @@ namespace Trading {
         MarketOrderBook& operator=(const MarketOrderBook&&) = delete;
 
     private:
-        auto priceToIndex(Price price) const {
-            return (price % ME_MAX_PRICE_LEVELS);
-        } 
-
-        MarketOrdersAtPrice* getOrdersAtPrice(Price price) const {
-            return price_orders_at_price_[priceToIndex(price)];
-        }
-
-        void addOrdersAtPrice(MarketOrdersAtPrice* new_orders_at_price);
-        void removeOrdersAtPrice(Side side, Price price);
-
         void addOrder(MarketOrder* order) noexcept;
         void removeOrder(MarketOrder* order) noexcept;
     };
 
     typedef std::array<MarketOrderBook*, ME_MAX_TICKERS> MarketOrderBookHashMap;
-}
\ No newline at end of file
+}
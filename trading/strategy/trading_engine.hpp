@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common/types.hpp"
+
+#include "market_data/market_update.hpp"
+
+using namespace Common;
+
+namespace Trading {
+    class MarketOrderBook;
+
+    /// What a MarketOrderBook reports back to the strategy driving it - every book change and every trade on the feed.
+    class TradingEngine {
+    public:
+        virtual ~TradingEngine() = default;
+
+        virtual void onOrderBookUpdate(TickerId ticker_id, Price price, Side side, MarketOrderBook* book) noexcept = 0;
+        virtual void onTradeUpdate(const Exchange::MEMarketUpdate* market_update, MarketOrderBook* book) noexcept = 0;
+    };
+}